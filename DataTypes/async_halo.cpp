@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file async_halo.cpp
+ * @brief Contains definitions of methods from the \e AsyncHalo class.
+ */
+
+#include "async_halo.h"
+
+/* Tags of the asynchronous messages, distinct from the ones of exchangeRealHalo() */
+#define TAG_ASYNC 100
+#define TAG_COUNT 200
+
+#ifdef USE_MPI
+/*!
+ * @brief Return the direction of the same interface as seen from the neighbor.
+ */
+static inline int opposite(int dir) {
+    return dir ^ 1;
+}
+#endif
+
+AsyncHalo::AsyncHalo(Vector &in_vec) : vec(in_vec) {
+
+#ifdef USE_MPI
+    Neighbors ngb = vec.getDimensions().getDecomposition().getNgbPid();
+
+    comm = vec.getDimensions().getDecomposition().getCommunicator();
+
+    ngb_pid[HALO_DIR_WEST] = ngb.west;
+    ngb_pid[HALO_DIR_EAST] = ngb.east;
+    ngb_pid[HALO_DIR_SOUTH] = ngb.south;
+    ngb_pid[HALO_DIR_NORTH] = ngb.north;
+
+    chunk_size[HALO_DIR_WEST] = vec.halo_chunk_size.west;
+    chunk_size[HALO_DIR_EAST] = vec.halo_chunk_size.east;
+    chunk_size[HALO_DIR_SOUTH] = vec.halo_chunk_size.south;
+    chunk_size[HALO_DIR_NORTH] = vec.halo_chunk_size.north;
+
+    chunk_start[HALO_DIR_WEST] = vec.halo_chunk_start_index.west;
+    chunk_start[HALO_DIR_EAST] = vec.halo_chunk_start_index.east;
+    chunk_start[HALO_DIR_SOUTH] = vec.halo_chunk_start_index.south;
+    chunk_start[HALO_DIR_NORTH] = vec.halo_chunk_start_index.north;
+
+    send_ids[HALO_DIR_WEST] = &vec.on_boarder_ids.west;
+    send_ids[HALO_DIR_EAST] = &vec.on_boarder_ids.east;
+    send_ids[HALO_DIR_SOUTH] = &vec.on_boarder_ids.south;
+    send_ids[HALO_DIR_NORTH] = &vec.on_boarder_ids.north;
+
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        snd_req[dir] = MPI_REQUEST_NULL;
+        rcv_req[dir] = MPI_REQUEST_NULL;
+        num_sent[dir] = 0;
+        num_received[dir] = 0;
+        if (ngb_pid[dir] != EMPTY) {
+            snd_buf[dir].resize(send_ids[dir]->size());
+            rcv_buf[dir].resize(chunk_size[dir]);
+        }
+    }
+#endif
+}
+
+void AsyncHalo::start() {
+
+#ifdef USE_MPI
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        if (ngb_pid[dir] == EMPTY)
+            continue;
+        /* The neighbor sends data towards us, i.e. in the opposite direction. */
+        MPI_Irecv(rcv_buf[dir].data(), chunk_size[dir], MPI_DOUBLE, ngb_pid[dir],
+                  TAG_ASYNC + opposite(dir), comm, &rcv_req[dir]);
+        send(dir);
+    }
+#endif
+}
+
+void AsyncHalo::progress() {
+
+#ifdef USE_MPI
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        int flag = 0;
+
+        if (ngb_pid[dir] == EMPTY)
+            continue;
+
+        /* Consume all arrived messages, the last one holds the freshest values. */
+        MPI_Test(&rcv_req[dir], &flag, MPI_STATUS_IGNORE);
+        while (flag) {
+            unpack(dir);
+            MPI_Irecv(rcv_buf[dir].data(), chunk_size[dir], MPI_DOUBLE, ngb_pid[dir],
+                      TAG_ASYNC + opposite(dir), comm, &rcv_req[dir]);
+            MPI_Test(&rcv_req[dir], &flag, MPI_STATUS_IGNORE);
+        }
+
+        /* Send only if the previous message has left, so sends don't pile up. */
+        MPI_Test(&snd_req[dir], &flag, MPI_STATUS_IGNORE);
+        if (flag)
+            send(dir);
+    }
+#endif
+}
+
+void AsyncHalo::finish() {
+
+#ifdef USE_MPI
+    long num_expected[HALO_NUM_DIRS] = {0, 0, 0, 0};
+    MPI_Request cnt_req[2 * HALO_NUM_DIRS];
+    int num_req = 0;
+
+    /* Tell every neighbor how many messages it should expect from us. */
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        if (ngb_pid[dir] == EMPTY)
+            continue;
+        MPI_Irecv(&num_expected[dir], 1, MPI_LONG, ngb_pid[dir], TAG_COUNT,
+                  comm, &cnt_req[num_req++]);
+        MPI_Isend(&num_sent[dir], 1, MPI_LONG, ngb_pid[dir], TAG_COUNT,
+                  comm, &cnt_req[num_req++]);
+    }
+    MPI_Waitall(num_req, cnt_req, MPI_STATUSES_IGNORE);
+
+    /* Receive the messages that are still in flight. */
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        if (ngb_pid[dir] == EMPTY)
+            continue;
+        while (num_received[dir] < num_expected[dir]) {
+            MPI_Wait(&rcv_req[dir], MPI_STATUS_IGNORE);
+            unpack(dir);
+            if (num_received[dir] < num_expected[dir])
+                MPI_Irecv(rcv_buf[dir].data(), chunk_size[dir], MPI_DOUBLE, ngb_pid[dir],
+                          TAG_ASYNC + opposite(dir), comm, &rcv_req[dir]);
+        }
+        /* Nothing else will arrive, drop the last posted receive. */
+        if (rcv_req[dir] != MPI_REQUEST_NULL) {
+            MPI_Cancel(&rcv_req[dir]);
+            MPI_Wait(&rcv_req[dir], MPI_STATUS_IGNORE);
+        }
+    }
+
+    MPI_Waitall(HALO_NUM_DIRS, snd_req, MPI_STATUSES_IGNORE);
+#endif
+}
+
+#ifdef USE_MPI
+void AsyncHalo::send(int dir) {
+
+    const vector<int> &ids = *send_ids[dir];
+    double *data = vec.getData();
+
+    for(int n = 0; n < (int)ids.size(); ++n) {
+#pragma omp atomic read
+        snd_buf[dir][n] = data[ids[n]];
+    }
+    MPI_Isend(snd_buf[dir].data(), snd_buf[dir].size(), MPI_DOUBLE, ngb_pid[dir],
+              TAG_ASYNC + dir, comm, &snd_req[dir]);
+    ++num_sent[dir];
+}
+
+void AsyncHalo::unpack(int dir) {
+
+    double *data = vec.getData() + chunk_start[dir];
+
+    for(int n = 0; n < chunk_size[dir]; ++n) {
+#pragma omp atomic write
+        data[n] = rcv_buf[dir][n];
+    }
+    ++num_received[dir];
+}
+#endif
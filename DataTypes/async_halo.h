@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file async_halo.h
+ * @brief Contains declaration of the \e AsyncHalo class.
+ */
+
+#ifndef ASYNC_HALO_H
+#define ASYNC_HALO_H
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include <vector>
+#include "vector.h"
+
+using namespace std;
+
+/*!
+ * @class AsyncHalo
+ * @brief Asynchronous exchange of the halo elements of a \e Vector.
+ *
+ * Every call to progress() unpacks whatever messages from the neighbors have
+ * arrived so far and sends fresh on-border values to the neighbors whose
+ * previous message has already left. Nobody waits for anybody, so the halo
+ * elements hold the most recent values that have arrived.
+ *
+ * @note Halo elements may be read by other threads while progress() runs,
+ * that's why the elements are accessed atomically.
+ */
+class AsyncHalo {
+    Vector &vec;                    // Vector which halo is exchanged
+#ifdef USE_MPI
+    int ngb_pid[HALO_NUM_DIRS];                 // Neighbors: west, east, south, north
+    int chunk_size[HALO_NUM_DIRS];              // Number of halo elements from each neighbor
+    int chunk_start[HALO_NUM_DIRS];             // Starting index of halo elements from each neighbor
+    const vector<int> *send_ids[HALO_NUM_DIRS]; // On-border elements sent to each neighbor
+    vector<double> snd_buf[HALO_NUM_DIRS];      // Send buffers
+    vector<double> rcv_buf[HALO_NUM_DIRS];      // Receive buffers
+    MPI_Request snd_req[HALO_NUM_DIRS];         // Requests of the sends in flight
+    MPI_Request rcv_req[HALO_NUM_DIRS];         // Requests of the posted receives
+    long num_sent[HALO_NUM_DIRS];               // Number of messages sent to each neighbor
+    long num_received[HALO_NUM_DIRS];           // Number of messages received from each neighbor
+    MPI_Comm comm;                  // Communicator of the neighbors
+#endif
+
+public:
+    /*!
+     * @brief Constructor.
+     * @param in_vec [in] Vector which halo is exchanged
+     */
+    AsyncHalo(Vector &in_vec);
+
+    AsyncHalo(const AsyncHalo&) = delete;
+    AsyncHalo& operator=(const AsyncHalo&) = delete;
+
+    /*!
+     * @brief Post receives and send the current on-border values.
+     */
+    void start();
+
+    /*!
+     * @brief Unpack arrived messages and send fresh values where possible.
+     */
+    void progress();
+
+    /*!
+     * @brief Stop sending and receive all messages that are still in flight.
+     * @note This is a collective call among the neighbors.
+     */
+    void finish();
+
+#ifdef USE_MPI
+    /*!
+     * @brief Get the number of messages sent to the neighbor.
+     * @param dir [in] Direction of the neighbor
+     */
+    inline long getNumSent(int dir) const { return num_sent[dir]; }
+
+    /*!
+     * @brief Get the number of messages received from the neighbor.
+     * @param dir [in] Direction of the neighbor
+     */
+    inline long getNumReceived(int dir) const { return num_received[dir]; }
+#endif
+
+private:
+#ifdef USE_MPI
+    /*!
+     * @brief Pack the on-border values and send them to the neighbor.
+     * @param dir [in] Direction of the neighbor
+     */
+    void send(int dir);
+
+    /*!
+     * @brief Copy the received message into the halo elements.
+     * @param dir [in] Direction of the neighbor
+     */
+    void unpack(int dir);
+#endif
+};
+
+#endif
@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file halo_plan.cpp
+ * @brief Contains definitions of methods from the \e HaloPlan class.
+ */
+
+#include <algorithm>
+#include <utility>
+#include "halo_plan.h"
+
+#define TAG_LAYOUT 300
+
+HaloPlan::HaloPlan() : halo_comm(HALO_P2P), precision(PRECISION_DOUBLE), bound_data(nullptr),
+                       committed(false) {
+
+#ifdef USE_MPI
+    comm = MPI_COMM_NULL;
+    lowp_started = false;
+    coll_request = MPI_REQUEST_NULL;
+    node_comm = MPI_COMM_NULL;
+    win = MPI_WIN_NULL;
+    ngb_group = MPI_GROUP_NULL;
+    export_buf = nullptr;
+    export_size = 0;
+    parity = 0;
+#endif
+}
+
+HaloPlan& HaloPlan::operator=(const HaloPlan &other) {
+
+    if (this != &other)
+        clear();
+
+    return *this;
+}
+
+HaloPlan::~HaloPlan() {
+
+    clear();
+}
+
+void HaloPlan::addNeighbor(int dir, int ngb_pid, int tag, const vector<int> &send_ids,
+                           int recv_start, int recv_size) {
+
+    Link &link = links[dir];
+
+    link.ngb_pid = ngb_pid;
+    link.tag = tag;
+    link.send_ids = send_ids;
+    link.recv_start = recv_start;
+    link.recv_size = recv_size;
+}
+
+void HaloPlan::commit(const Decomposition &decomp, double *data) {
+
+    halo_comm = decomp.getHaloComm();
+    bound_data = data;
+
+#ifdef USE_MPI
+    comm = decomp.getCommunicator();
+
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        Link &link = links[dir];
+        if (link.ngb_pid == EMPTY)
+            continue;
+        createSendType(link);
+        MPI_Type_contiguous(link.recv_size, MPI_DOUBLE, &link.rcv_type);
+        MPI_Type_commit(&link.rcv_type);
+    }
+
+    if (halo_comm == HALO_NEIGHBOR) {
+        /*
+         * Missing neighbors are MPI_PROC_NULL in the Cartesian communicator,
+         * their entries are not used, but have to be valid.
+         */
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            const Link &link = links[dir];
+            bool exists = (link.ngb_pid != EMPTY);
+            snd_counts[dir] = exists ? 1 : 0;
+            rcv_counts[dir] = exists ? 1 : 0;
+            snd_displs[dir] = exists ? link.send_start * sizeof(double) : 0;
+            rcv_displs[dir] = exists ? link.recv_start * sizeof(double) : 0;
+            snd_types[dir] = exists ? link.snd_type : MPI_DOUBLE;
+            rcv_types[dir] = exists ? link.rcv_type : MPI_DOUBLE;
+        }
+    }
+    else if (halo_comm == HALO_RMA) {
+        commitRma(data);
+    }
+    else {
+        if (halo_comm == HALO_SHARED)
+            commitShared(decomp);
+
+        /* Receives come first, so they are started before the sends. */
+        requests.assign(2 * HALO_NUM_DIRS, MPI_REQUEST_NULL);
+        lowp_requests.assign(2 * HALO_NUM_DIRS, MPI_REQUEST_NULL);
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            Link &link = links[dir];
+            if (link.ngb_pid == EMPTY || link.node_rank != MPI_UNDEFINED)
+                continue;
+            MPI_Recv_init(data + link.recv_start, 1, link.rcv_type, link.ngb_pid,
+                          link.tag, comm, &requests[dir]);
+            MPI_Send_init(data + link.send_start, 1, link.snd_type, link.ngb_pid,
+                          link.tag, comm, &requests[HALO_NUM_DIRS + dir]);
+
+            /* Both sides start decoding from zero */
+            link.snd_lowp.assign(link.send_ids.size(), 0.0f);
+            link.rcv_lowp.assign(link.recv_size, 0.0f);
+            link.snd_ref.assign(link.send_ids.size(), 0.0);
+            link.rcv_ref.assign(link.recv_size, 0.0);
+            MPI_Recv_init(link.rcv_lowp.data(), link.recv_size, MPI_FLOAT, link.ngb_pid,
+                          link.tag, comm, &lowp_requests[dir]);
+            MPI_Send_init(link.snd_lowp.data(), link.send_ids.size(), MPI_FLOAT, link.ngb_pid,
+                          link.tag, comm, &lowp_requests[HALO_NUM_DIRS + dir]);
+        }
+    }
+#endif
+    committed = true;
+}
+
+void HaloPlan::clear() {
+
+#ifdef USE_MPI
+    int finalized = 0;
+
+    /* Plans may outlive MPI, e.g. in global objects. */
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        for(int r = 0; r < (int)requests.size(); ++r) {
+            if (requests[r] != MPI_REQUEST_NULL)
+                MPI_Request_free(&requests[r]);
+        }
+        for(int r = 0; r < (int)lowp_requests.size(); ++r) {
+            if (lowp_requests[r] != MPI_REQUEST_NULL)
+                MPI_Request_free(&lowp_requests[r]);
+        }
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            if (links[dir].snd_type != MPI_DATATYPE_NULL)
+                MPI_Type_free(&links[dir].snd_type);
+            if (links[dir].rcv_type != MPI_DATATYPE_NULL)
+                MPI_Type_free(&links[dir].rcv_type);
+        }
+        /* Collective over the node or all processes, as the plans are built */
+        if (win != MPI_WIN_NULL) {
+            if (halo_comm == HALO_SHARED)
+                MPI_Win_unlock_all(win);
+            MPI_Win_free(&win);
+        }
+        if (ngb_group != MPI_GROUP_NULL)
+            MPI_Group_free(&ngb_group);
+    }
+    requests.clear();
+    lowp_requests.clear();
+    lowp_started = false;
+    comm = MPI_COMM_NULL;
+    node_comm = MPI_COMM_NULL;
+    win = MPI_WIN_NULL;
+    ngb_group = MPI_GROUP_NULL;
+    export_buf = nullptr;
+    export_size = 0;
+    parity = 0;
+#endif
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        links[dir] = Link();
+    }
+    bound_data = nullptr;
+    committed = false;
+}
+
+void HaloPlan::swap(HaloPlan &other) {
+
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        std::swap(links[dir], other.links[dir]);
+    }
+    std::swap(halo_comm, other.halo_comm);
+    std::swap(precision, other.precision);
+    std::swap(bound_data, other.bound_data);
+#ifdef USE_MPI
+    std::swap(comm, other.comm);
+    requests.swap(other.requests);
+    lowp_requests.swap(other.lowp_requests);
+    std::swap(lowp_started, other.lowp_started);
+    std::swap(coll_request, other.coll_request);
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        std::swap(snd_counts[dir], other.snd_counts[dir]);
+        std::swap(rcv_counts[dir], other.rcv_counts[dir]);
+        std::swap(snd_displs[dir], other.snd_displs[dir]);
+        std::swap(rcv_displs[dir], other.rcv_displs[dir]);
+        std::swap(snd_types[dir], other.snd_types[dir]);
+        std::swap(rcv_types[dir], other.rcv_types[dir]);
+    }
+    std::swap(node_comm, other.node_comm);
+    std::swap(win, other.win);
+    std::swap(ngb_group, other.ngb_group);
+    std::swap(export_buf, other.export_buf);
+    std::swap(export_size, other.export_size);
+    std::swap(parity, other.parity);
+#endif
+    std::swap(committed, other.committed);
+}
+
+void HaloPlan::start(double *data) {
+
+#ifdef USE_MPI
+    if (halo_comm == HALO_NEIGHBOR) {
+        /* On-border (sent) and halo (received) elements never overlap. */
+        MPI_Ineighbor_alltoallw(data, snd_counts, snd_displs, snd_types,
+                                data, rcv_counts, rcv_displs, rcv_types, comm, &coll_request);
+        return;
+    }
+
+    if (halo_comm == HALO_RMA) {
+        if (win == MPI_WIN_NULL)
+            return;
+        /* Expose the halos to the neighbors and put the on-border elements into theirs */
+        MPI_Win_post(ngb_group, 0, win);
+        MPI_Win_start(ngb_group, 0, win);
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            const Link &link = links[dir];
+            if (link.ngb_pid == EMPTY)
+                continue;
+            MPI_Put(data + link.send_start, 1, link.snd_type, link.ngb_pid, link.target_start,
+                    link.send_ids.size(), MPI_DOUBLE, win);
+        }
+        return;
+    }
+
+    if (halo_comm == HALO_SHARED) {
+        double *slot = export_buf + parity * export_size;
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            const Link &link = links[dir];
+            if (link.node_rank == MPI_UNDEFINED)
+                continue;
+            for(int n = 0; n < (int)link.send_ids.size(); ++n) {
+                slot[link.export_start + n] = data[link.send_ids[n]];
+            }
+        }
+        MPI_Win_sync(win);
+    }
+
+    lowp_started = (precision != PRECISION_DOUBLE);
+    if (lowp_started) {
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            if (lowp_requests[HALO_NUM_DIRS + dir] != MPI_REQUEST_NULL)
+                packLowPrecision(links[dir], data);
+        }
+    }
+
+    vector<MPI_Request> &active = lowp_started ? lowp_requests : requests;
+    for(int r = 0; r < 2 * HALO_NUM_DIRS; ++r) {
+        if (active[r] != MPI_REQUEST_NULL)
+            MPI_Start(&active[r]);
+    }
+#endif
+}
+
+void HaloPlan::finish() {
+
+#ifdef USE_MPI
+    if (halo_comm == HALO_NEIGHBOR) {
+        MPI_Wait(&coll_request, MPI_STATUS_IGNORE);
+    }
+    else if (halo_comm == HALO_RMA) {
+        if (win == MPI_WIN_NULL)
+            return;
+        /* The puts of this process, then the puts into its halos are complete */
+        MPI_Win_complete(win);
+        MPI_Win_wait(win);
+    }
+    else if (lowp_started) {
+        MPI_Waitall(2 * HALO_NUM_DIRS, lowp_requests.data(), MPI_STATUSES_IGNORE);
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            if (lowp_requests[dir] != MPI_REQUEST_NULL)
+                unpackLowPrecision(links[dir], bound_data);
+        }
+    }
+    else
+        MPI_Waitall(2 * HALO_NUM_DIRS, requests.data(), MPI_STATUSES_IGNORE);
+
+    if (halo_comm == HALO_SHARED) {
+        /* All the exports of the node are complete after the barrier */
+        MPI_Barrier(node_comm);
+        MPI_Win_sync(win);
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            const Link &link = links[dir];
+            if (link.node_rank == MPI_UNDEFINED)
+                continue;
+            const double *slot = link.ngb_export + parity * link.ngb_slot_size;
+            for(int n = 0; n < link.recv_size; ++n) {
+                bound_data[link.recv_start + n] = slot[n];
+            }
+        }
+        parity = 1 - parity;
+    }
+#endif
+}
+
+#ifdef USE_MPI
+void HaloPlan::createSendType(Link &link) {
+
+    const vector<int> &ids = link.send_ids;
+    int count = ids.size();
+    int stride = (count > 1) ? ids[1] - ids[0] : 1;
+    bool strided = (stride > 0);
+
+    for(int n = 1; n < count && strided; ++n) {
+        strided = (ids[n] - ids[n - 1] == stride);
+    }
+
+    if (strided) {
+        link.send_start = (count > 0) ? ids[0] : 0;
+        MPI_Type_vector(count, 1, stride, MPI_DOUBLE, &link.snd_type);
+    }
+    else {
+        link.send_start = 0;
+        MPI_Type_create_indexed_block(count, 1, ids.data(), MPI_DOUBLE, &link.snd_type);
+    }
+    MPI_Type_commit(&link.snd_type);
+}
+
+void HaloPlan::commitShared(const Decomposition &decomp) {
+
+    MPI_Group group, node_group;
+    MPI_Info info;
+    int layouts[HALO_NUM_DIRS][2];      // Export start and slot size sent to the neighbors
+    int ngb_layouts[HALO_NUM_DIRS][2];  // The same received from the neighbors
+
+    node_comm = decomp.getNodeCommunicator();
+    MPI_Comm_group(comm, &group);
+    MPI_Comm_group(node_comm, &node_group);
+
+    export_size = 0;
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        Link &link = links[dir];
+        if (link.ngb_pid == EMPTY)
+            continue;
+        MPI_Group_translate_ranks(group, 1, &link.ngb_pid, node_group, &link.node_rank);
+        if (link.node_rank == MPI_UNDEFINED)
+            continue;
+        link.export_start = export_size;
+        export_size += link.send_ids.size();
+    }
+    MPI_Group_free(&group);
+    MPI_Group_free(&node_group);
+
+    /* Every process allocates its slots close to itself */
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    MPI_Win_allocate_shared(2 * export_size * sizeof(double), sizeof(double), info, node_comm,
+                            &export_buf, &win);
+    MPI_Info_free(&info);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+    /* The neighbors tell each other where their exports are */
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        layouts[dir][0] = links[dir].export_start;
+        layouts[dir][1] = export_size;
+    }
+    exchangeLayouts(layouts, ngb_layouts);
+
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        Link &link = links[dir];
+        MPI_Aint size;
+        int disp_unit;
+        double *base;
+        if (link.node_rank == MPI_UNDEFINED)
+            continue;
+        MPI_Win_shared_query(win, link.node_rank, &size, &disp_unit, &base);
+        link.ngb_export = base + ngb_layouts[dir][0];
+        link.ngb_slot_size = ngb_layouts[dir][1];
+    }
+    parity = 0;
+}
+
+void HaloPlan::commitRma(double *data) {
+
+    MPI_Group group;
+    MPI_Info info;
+    int ngb_ranks[HALO_NUM_DIRS];
+    int num_ngbs = 0;
+    int layouts[HALO_NUM_DIRS][2];      // Halo chunk received from each neighbor
+    int ngb_layouts[HALO_NUM_DIRS][2];  // Halo chunk of the neighbor filled by this process
+    int win_size = 0;
+    int num_procs;
+
+    /* A single process has no halos (and some libraries can't create its window) */
+    MPI_Comm_size(comm, &num_procs);
+    if (num_procs == 1)
+        return;
+
+    /* The halo chunks are stored after the real elements */
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        const Link &link = links[dir];
+        if (link.ngb_pid == EMPTY)
+            continue;
+        ngb_ranks[num_ngbs++] = link.ngb_pid;
+        layouts[dir][0] = link.recv_start;
+        layouts[dir][1] = link.recv_size;
+        win_size = max(win_size, link.recv_start + link.recv_size);
+    }
+    exchangeLayouts(layouts, ngb_layouts);
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        if (links[dir].ngb_pid != EMPTY)
+            links[dir].target_start = ngb_layouts[dir][0];
+    }
+
+    MPI_Comm_group(comm, &group);
+    MPI_Group_incl(group, num_ngbs, ngb_ranks, &ngb_group);
+    MPI_Group_free(&group);
+
+    /* Only the active target synchronization is used */
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "no_locks", "true");
+    MPI_Win_create(data, win_size * sizeof(double), sizeof(double), info, comm, &win);
+    MPI_Info_free(&info);
+}
+
+void HaloPlan::exchangeLayouts(int layouts[HALO_NUM_DIRS][2], int ngb_layouts[HALO_NUM_DIRS][2]) {
+
+    MPI_Request layout_requests[2 * HALO_NUM_DIRS];
+
+    for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+        const Link &link = links[dir];
+        layout_requests[dir] = MPI_REQUEST_NULL;
+        layout_requests[HALO_NUM_DIRS + dir] = MPI_REQUEST_NULL;
+        if (link.ngb_pid == EMPTY)
+            continue;
+        if (halo_comm == HALO_SHARED && link.node_rank == MPI_UNDEFINED)
+            continue;
+        MPI_Irecv(ngb_layouts[dir], 2, MPI_INT, link.ngb_pid, TAG_LAYOUT, comm,
+                  &layout_requests[dir]);
+        MPI_Isend(layouts[dir], 2, MPI_INT, link.ngb_pid, TAG_LAYOUT, comm,
+                  &layout_requests[HALO_NUM_DIRS + dir]);
+    }
+    MPI_Waitall(2 * HALO_NUM_DIRS, layout_requests, MPI_STATUSES_IGNORE);
+}
+
+void HaloPlan::packLowPrecision(Link &link, const double *data) {
+
+    for(int n = 0; n < (int)link.send_ids.size(); ++n) {
+        double value = data[link.send_ids[n]];
+        /* The reference follows the rounded values, as decoded by the neighbor */
+        if (precision == PRECISION_DELTA) {
+            link.snd_lowp[n] = (float)(value - link.snd_ref[n]);
+            link.snd_ref[n] += link.snd_lowp[n];
+        }
+        else {
+            link.snd_lowp[n] = (float)value;
+            link.snd_ref[n] = link.snd_lowp[n];
+        }
+    }
+}
+
+void HaloPlan::unpackLowPrecision(Link &link, double *data) {
+
+    for(int n = 0; n < link.recv_size; ++n) {
+        if (precision == PRECISION_DELTA)
+            link.rcv_ref[n] += link.rcv_lowp[n];
+        else
+            link.rcv_ref[n] = link.rcv_lowp[n];
+        data[link.recv_start + n] = link.rcv_ref[n];
+    }
+}
+#endif
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file halo_plan.h
+ * @brief Contains declaration of the \e HaloPlan class.
+ */
+
+#ifndef HALO_PLAN_H
+#define HALO_PLAN_H
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include <vector>
+#include "../MPI/Decomposition/decomposition.h"
+
+using namespace std;
+
+/* Directions of the neighbors, in the order of the neighbors of a Cartesian communicator */
+enum {
+    HALO_DIR_WEST,
+    HALO_DIR_EAST,
+    HALO_DIR_SOUTH,
+    HALO_DIR_NORTH,
+    HALO_NUM_DIRS
+};
+
+/*!
+ * @class HaloPlan
+ * @brief Persistent plan of the halo exchange of a vector layout.
+ *
+ * The plan is built once. Derived datatypes describe the on-border elements
+ * (strided rows/columns) and the halo chunks in place, so MPI sends from and
+ * receives into the vector storage directly, without packing. Depending on the
+ * decomposition, the plan keeps either persistent MPI requests bound to the
+ * storage (HALO_P2P), or the arguments of a single neighborhood collective
+ * (HALO_NEIGHBOR). Every exchange then only starts the communication and
+ * waits for it.
+ *
+ * With HALO_SHARED, neighbors on the same node exchange through a shared
+ * memory window: every process exports its on-border elements into its part
+ * of the window, and the neighbors load them directly after a barrier of the
+ * node. The window has two slots used in turn, so a neighbor still reading
+ * the previous exchange is never overwritten and one barrier per exchange is
+ * enough. Neighbors on other nodes use the persistent requests.
+ *
+ * With HALO_RMA, the storage is exposed in a window and every process puts its
+ * on-border elements into the halos of the neighbors. The epochs are
+ * synchronized by post-start-complete-wait within the group of the neighbors.
+ *
+ * The messages of the persistent requests may be sent in reduced precision
+ * (see PRECISION_* in macro.h): rounded to float, or as the change since the
+ * previous exchange rounded to float. Both sides keep the values decoded so
+ * far, so the rounding errors of the changes don't accumulate, and the
+ * changes, hence the errors, shrink as the iterations converge. The other
+ * ways of the exchange always use full precision.
+ *
+ * @note A copy of the plan is empty, i.e. the requests are never shared, the
+ * copy has to be built again.
+ */
+class HaloPlan {
+    /*!
+     * @brief Communication with one neighbor.
+     */
+    struct Link {
+        int ngb_pid = EMPTY;        // Rank of the neighbor
+        int tag = 0;                // Tag of the messages in both directions
+        vector<int> send_ids;       // Elements sent to the neighbor
+        int send_start = 0;         // Index of the first element sent
+        int recv_start = 0;         // Index of the first halo element received
+        int recv_size = 0;          // Number of halo elements received
+#ifdef USE_MPI
+        MPI_Datatype snd_type = MPI_DATATYPE_NULL;  // On-border elements, relative to send_start
+        MPI_Datatype rcv_type = MPI_DATATYPE_NULL;  // Halo elements, relative to recv_start
+        int node_rank = MPI_UNDEFINED;  // Rank of the neighbor in the node, if it shares the memory
+        int export_start = 0;           // Position of the exported elements in a slot of the window
+        const double *ngb_export = nullptr; // Elements exported by the neighbor (first slot)
+        int ngb_slot_size = 0;          // Size of a slot of the neighbor
+        int target_start = 0;           // Index of the first halo element of the neighbor (HALO_RMA)
+        vector<float> snd_lowp;         // Elements sent in reduced precision
+        vector<float> rcv_lowp;         // Elements received in reduced precision
+        vector<double> snd_ref;         // Values decoded by the neighbor so far
+        vector<double> rcv_ref;         // Values decoded from the neighbor so far
+#endif
+    };
+
+    Link links[HALO_NUM_DIRS];      // Communication with every neighbor
+    int halo_comm;                  // Way the halos are exchanged (see HALO_* in macro.h)
+    int precision;                  // Precision of the messages (see PRECISION_* in macro.h)
+    double *bound_data;             // Storage the persistent requests are bound to
+#ifdef USE_MPI
+    MPI_Comm comm;                  // Communicator of the neighbors
+    vector<MPI_Request> requests;   // Persistent requests: receives, then sends
+    vector<MPI_Request> lowp_requests;  // Same in reduced precision
+    bool lowp_started;              // True if the exchange in flight uses reduced precision
+    MPI_Request coll_request;       // Request of the neighborhood collective
+    /* Arguments of the neighborhood collective, must stay valid until it completes */
+    int snd_counts[HALO_NUM_DIRS], rcv_counts[HALO_NUM_DIRS];
+    MPI_Aint snd_displs[HALO_NUM_DIRS], rcv_displs[HALO_NUM_DIRS];
+    MPI_Datatype snd_types[HALO_NUM_DIRS], rcv_types[HALO_NUM_DIRS];
+    MPI_Comm node_comm;             // Processes sharing the memory of the node
+    MPI_Win win;                    // Window of the exported elements (HALO_SHARED)
+                                    // or of the storage (HALO_RMA)
+    MPI_Group ngb_group;            // Neighbors, the targets and origins of the puts
+    double *export_buf;             // Local part of the window: two slots
+    int export_size;                // Size of a slot
+    int parity;                     // Slot used by the next exchange
+#endif
+    bool committed;                 // True once the requests are created
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    HaloPlan();
+
+    /*!
+     * @brief Copy constructor, creates an empty plan.
+     */
+    HaloPlan(const HaloPlan&) : HaloPlan() { }
+
+    /*!
+     * @brief Assignment operator, leaves the plan empty.
+     */
+    HaloPlan& operator=(const HaloPlan &other);
+
+    /*!
+     * @brief Destructor, frees the persistent requests.
+     */
+    ~HaloPlan();
+
+    /*!
+     * @brief Check whether the plan is ready to be used with the storage.
+     * @param data [in] Elements of the vector
+     */
+    inline bool isCommitted(const double *data) const {
+        return committed && data == bound_data;
+    }
+
+    /*!
+     * @brief Set the precision of the following exchanges, it is kept when
+     * the plan is built again.
+     * @param in_precision [in] One of PRECISION_* (see macro.h)
+     */
+    inline void setPrecision(int in_precision) { precision = in_precision; }
+
+    /*!
+     * @brief Add a neighbor to the plan.
+     * @param dir [in] Direction of the neighbor (see HALO_DIR_*)
+     * @param ngb_pid [in] Rank of the neighbor
+     * @param tag [in] Tag of the messages
+     * @param send_ids [in] Elements sent to the neighbor
+     * @param recv_start [in] Index of the first halo element received from the neighbor
+     * @param recv_size [in] Number of halo elements received from the neighbor
+     */
+    void addNeighbor(int dir, int ngb_pid, int tag, const vector<int> &send_ids, int recv_start,
+                     int recv_size);
+
+    /*!
+     * @brief Create the datatypes and requests. The plan can't be changed afterwards.
+     * @param decomp [in] Decomposition, provides the communicator and the way
+     *                    the halos are exchanged
+     * @param data [in] Elements of the vector, the requests are bound to them
+     */
+    void commit(const Decomposition &decomp, double *data);
+
+    /*!
+     * @brief Free the requests and datatypes and remove all neighbors.
+     */
+    void clear();
+
+    /*!
+     * @brief Swap the plans of two vectors which swap their storage.
+     * @param other [in/out] Plan to swap with
+     */
+    void swap(HaloPlan &other);
+
+    /*!
+     * @brief Start the exchange.
+     * @note The on-border elements are sent in place, they shouldn't be
+     * modified until the exchange is finished.
+     * @param data [in/out] Elements of the vector
+     */
+    void start(double *data);
+
+    /*!
+     * @brief Wait for the exchange to complete. With HALO_SHARED, the halos of
+     * the neighbors on the same node are loaded here.
+     */
+    void finish();
+
+private:
+#ifdef USE_MPI
+    /*!
+     * @brief Create the datatype of the elements sent to the neighbor.
+     * Equally spaced elements (rows and columns of the grid) are described by
+     * a strided vector type, any other set by an indexed one.
+     * @param link [in/out] Communication with the neighbor
+     */
+    void createSendType(Link &link);
+
+    /*!
+     * @brief Find the neighbors on the same node and create the shared window
+     * of the exported elements.
+     * @param decomp [in] Decomposition, provides the communicator of the node
+     */
+    void commitShared(const Decomposition &decomp);
+
+    /*!
+     * @brief Expose the storage in a window and create the group of the neighbors.
+     * @param data [in] Elements of the vector
+     */
+    void commitRma(double *data);
+
+    /*!
+     * @brief Exchange two integers with every neighbor the plan communicates
+     * with directly, e.g. positions in the storage.
+     * @param layouts [in] Integers sent in each direction
+     * @param ngb_layouts [out] Integers received from each direction
+     */
+    void exchangeLayouts(int layouts[HALO_NUM_DIRS][2], int ngb_layouts[HALO_NUM_DIRS][2]);
+
+    /*!
+     * @brief Encode the on-border elements in reduced precision.
+     * @param link [in/out] Communication with the neighbor
+     * @param data [in] Elements of the vector
+     */
+    void packLowPrecision(Link &link, const double *data);
+
+    /*!
+     * @brief Decode the halo elements received in reduced precision.
+     * @param link [in/out] Communication with the neighbor
+     * @param data [out] Elements of the vector
+     */
+    void unpackLowPrecision(Link &link, double *data);
+#endif
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file stencil.cpp
+ * @brief Contains definition of methods from the \e Stencil class.
+ */
+
+#include "stencil.h"
+
+void Stencil::assemble(Matrix &A, Field &T) {
+
+    IndicesBegEnd int_ind_i = T.getDimensions().getInternalIndRangeI();
+    IndicesBegEnd int_ind_j = T.getDimensions().getInternalIndRangeJ();
+    IndicesIJ num_elts = T.getDimensions().getNumElts();
+    int size = 0;
+
+    elts = T.getDimensions().getNumEltsLoc();
+    size = elts.i * elts.j;
+
+    central.assign(size, 0.0);
+    east.assign(size, 0.0);
+    west.assign(size, 0.0);
+    south.assign(size, 0.0);
+    north.assign(size, 0.0);
+    id_east.assign(size, EMPTY);
+    id_west.assign(size, EMPTY);
+    id_south.assign(size, EMPTY);
+    id_north.assign(size, EMPTY);
+
+    /*
+     * The rows of the matrix follow the enumeration of the field, so the
+     * neighbors are found by their grid indices. Missing neighbors (i.e.
+     * physical boundaries) are already accounted for in the diagonal.
+     */
+    for(int i = int_ind_i.beg; i <= int_ind_i.end; ++i) {
+        for(int j = int_ind_j.beg; j <= int_ind_j.end; ++j) {
+
+            int row = T.getID(i, j);
+
+            central[row] = A(row, row);
+
+            if (i > 0) {
+                id_west[row] = T.getID(i - 1, j);
+                west[row] = A(row, id_west[row]);
+            }
+            if (i < num_elts.i - 1) {
+                id_east[row] = T.getID(i + 1, j);
+                east[row] = A(row, id_east[row]);
+            }
+            if (j > 0) {
+                id_south[row] = T.getID(i, j - 1);
+                south[row] = A(row, id_south[row]);
+            }
+            if (j < num_elts.j - 1) {
+                id_north[row] = T.getID(i, j + 1);
+                north[row] = A(row, id_north[row]);
+            }
+        }
+    }
+
+    /* Cells which can only be updated once the halo elements have arrived */
+    boundary_cells.clear();
+    on_boundary.assign(size, 0);
+    for(int n = 0; n < size; ++n) {
+        if (id_west[n] >= size || id_east[n] >= size || id_south[n] >= size || id_north[n] >= size) {
+            on_boundary[n] = 1;
+            boundary_cells.push_back(n);
+        }
+    }
+}
+
+void Stencil::calculateResidual(Vector &x, Vector &b, Vector &res) const {
+
+    const double *x_data = x.getData();
+    int size = elts.i * elts.j;
+
+#pragma omp parallel for
+    for(int n = 0; n < size; ++n) {
+        res(n) = b(n) - central[n] * x_data[n] - offDiagonal(x_data, n);
+    }
+}
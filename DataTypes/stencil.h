@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file stencil.h
+ * @brief Contains declaration of the \e Stencil class.
+ */
+
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include <vector>
+#include "matrix.h"
+#include "vector.h"
+#include "field.h"
+#include "../General/structs.h"
+
+using namespace std;
+
+/*!
+ * @class Stencil
+ * @brief Represents the local matrix in a form of a 5-point stencil.
+ * Coefficients are stored per direction for every local (real) cell, in the
+ * same order as the real elements of \e Vector. Neighbors that don't exist
+ * (physical boundary) have zero coefficient and EMPTY index.
+ */
+class Stencil {
+    IndicesIJ elts;                 // Number of local elements in each direction
+    vector<double> central;         // Diagonal coefficients
+    vector<double> east;            // Coefficients of the east neighbors
+    vector<double> west;            // Coefficients of the west neighbors
+    vector<double> south;           // Coefficients of the south neighbors
+    vector<double> north;           // Coefficients of the north neighbors
+    vector<int> id_east;            // Vector IDs of the east neighbors
+    vector<int> id_west;            // Vector IDs of the west neighbors
+    vector<int> id_south;           // Vector IDs of the south neighbors
+    vector<int> id_north;           // Vector IDs of the north neighbors
+    vector<int> boundary_cells;     // Cells coupled to at least one halo element
+    vector<char> on_boundary;       // Flag of every cell, true for the boundary cells
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    Stencil() : elts(0, 0) { }
+
+    /*!
+     * @brief Extract the stencil coefficients from the assembled matrix.
+     * @param A [in] Matrix
+     * @param T [in] Field, used to map the grid indices to the matrix rows
+     */
+    void assemble(Matrix &A, Field &T);
+
+    /*!
+     * @brief Calculate the residual \f[ r = b - Ax \f] on the real cells.
+     * @note Halo elements of \e x should be up to date.
+     * @param x [in] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param res [out] Vector of residual
+     */
+    void calculateResidual(Vector &x, Vector &b, Vector &res) const;
+
+    /*!
+     * @brief Return the number of local elements in each direction.
+     */
+    inline IndicesIJ getNumElts() const { return elts; }
+
+    /*!
+     * @brief Return the number of local elements.
+     */
+    inline int size() const { return elts.i * elts.j; }
+
+    /*!
+     * @brief Return the vector ID of the element with local indices (i, j).
+     */
+    inline int getID(int i, int j) const { return j + i * elts.j; }
+
+    inline double getCentral(int n) const { return central[n]; }
+    inline double getEast(int n) const { return east[n]; }
+    inline double getWest(int n) const { return west[n]; }
+    inline double getSouth(int n) const { return south[n]; }
+    inline double getNorth(int n) const { return north[n]; }
+
+    inline int getIdEast(int n) const { return id_east[n]; }
+    inline int getIdWest(int n) const { return id_west[n]; }
+    inline int getIdSouth(int n) const { return id_south[n]; }
+    inline int getIdNorth(int n) const { return id_north[n]; }
+
+    /*!
+     * @brief Return the cells that depend on the halo elements, in ascending order.
+     */
+    inline const vector<int> &getBoundaryCells() const { return boundary_cells; }
+
+    /*!
+     * @brief Check whether the cell depends on the halo elements.
+     * @param n [in] Row
+     */
+    inline bool isOnBoundary(int n) const { return on_boundary[n] != 0; }
+
+    /*!
+     * @brief Return the sum of off-diagonal contributions \f[ \sum_{k \ne n} A_{nk} x_k \f].
+     * @param x [in] Raw data of the vector of unknowns, including halo elements
+     * @param n [in] Row
+     */
+    inline double offDiagonal(const double *x, int n) const {
+        double sum = 0.0;
+        if (id_west[n] != EMPTY)
+            sum += west[n] * x[id_west[n]];
+        if (id_east[n] != EMPTY)
+            sum += east[n] * x[id_east[n]];
+        if (id_south[n] != EMPTY)
+            sum += south[n] * x[id_south[n]];
+        if (id_north[n] != EMPTY)
+            sum += north[n] * x[id_north[n]];
+        return sum;
+    }
+
+    /*!
+     * @brief Same as offDiagonal(), but the elements of \e x are read
+     *        atomically, so other threads may update them concurrently.
+     * @param x [in] Raw data of the vector of unknowns, including halo elements
+     * @param n [in] Row
+     */
+    inline double offDiagonalShared(const double *x, int n) const {
+        double sum = 0.0;
+        double value;
+        if (id_west[n] != EMPTY) {
+#pragma omp atomic read
+            value = x[id_west[n]];
+            sum += west[n] * value;
+        }
+        if (id_east[n] != EMPTY) {
+#pragma omp atomic read
+            value = x[id_east[n]];
+            sum += east[n] * value;
+        }
+        if (id_south[n] != EMPTY) {
+#pragma omp atomic read
+            value = x[id_south[n]];
+            sum += south[n] * value;
+        }
+        if (id_north[n] != EMPTY) {
+#pragma omp atomic read
+            value = x[id_north[n]];
+            sum += north[n] * value;
+        }
+        return sum;
+    }
+};
+
+#endif
@@ -29,6 +29,10 @@
 #ifdef USE_MPI
 #include <mpi.h>
 #endif
+#include "../MPI/threads.h"
+
+#define HALO_TAG_WE 1       // Tag of the halos between the west and east neighbors
+#define HALO_TAG_SN 2       // Tag of the halos between the south and north neighbors
 
 void Vector::associateChunkData(const int num_elts, int &_halo_start_index,
                                 int &_chunk_size, int &_chunk_start_index) {
@@ -105,104 +109,98 @@ void Vector::resize(Dimensions const &in_dims) {
                                     + (dims.getInternalIndRangeJ().end - dims.getInternalIndRangeJ().beg + 1) * i;
         }
     }
+
+#ifdef USE_MPI
+    /* The layout and the storage may have changed, so the plan is rebuilt. */
+    buildHaloPlan();
+#endif
 }
 
 void Vector::exchangeRealHalo() {
 
-#ifndef USE_MPI
+    startHaloExchange();
+    finishHaloExchange();
+}
+
+void Vector::startHaloExchange() {
+
+#if defined(USE_THREADS)
+    Neighbors ngb_pid = dims.getDecomposition().getNgbPid();
+
+    /* The mailboxes keep copies of the messages, so the sends return immediately. */
+    if (ngb_pid.west != EMPTY)
+        sendHalo(ngb_pid.west, HALO_TAG_WE, on_boarder_ids.west);
+    if (ngb_pid.east != EMPTY)
+        sendHalo(ngb_pid.east, HALO_TAG_WE, on_boarder_ids.east);
+    if (ngb_pid.south != EMPTY)
+        sendHalo(ngb_pid.south, HALO_TAG_SN, on_boarder_ids.south);
+    if (ngb_pid.north != EMPTY)
+        sendHalo(ngb_pid.north, HALO_TAG_SN, on_boarder_ids.north);
+#elif !defined(USE_MPI)
     // no need to communicate in a non-MPI code
     return;
 #else
+    /* The plan is bound to the storage, rebuild it if the storage has moved. */
+    if (!halo_plan.isCommitted(data.data()))
+        buildHaloPlan();
 
-    int my_rank = getMyRank();
-    int num_procs = getNumProcs();
-    vector<double> snd_buf_we, rcv_buf_we;                      // Send/receive buffers for the west/east Neighbors
-    vector<double> snd_buf_sn, rcv_buf_sn;                      // Send/receive buffers for the south/north Neighbors
-    Neighbors ngb_pid = dims.getDecomposition().getNgbPid();
-    int imax_loc = dims.getNumEltsLoc().i;
-    int jmax_loc = dims.getNumEltsLoc().j;
-    MPI_Status status;
-    int tag_we = 1;
-    int tag_sn = 2;
+    halo_plan.start(data.data());
+#endif
+}
 
-    // Pre-allocate buffers
-    snd_buf_we.resize(jmax_loc);
-    rcv_buf_we.resize(jmax_loc);
+void Vector::finishHaloExchange() {
 
-    snd_buf_sn.resize(imax_loc);
-    rcv_buf_sn.resize(imax_loc);
+#if defined(USE_THREADS)
+    Neighbors ngb_pid = dims.getDecomposition().getNgbPid();
 
-    /* ****************************************************************************************** */
-    // Assemble send buffers to west
-    if (ngb_pid.west != EMPTY) {
-        for(int n = 0; n < halo_chunk_size.west; ++n) {
-            snd_buf_we[n] = data[on_boarder_ids.west[n]];
-        }
-        MPI_Send(snd_buf_we.data(), snd_buf_we.size(), MPI_DOUBLE, ngb_pid.west, tag_we, MPI_COMM_WORLD);
-    }
+    if (ngb_pid.west != EMPTY)
+        threadRecv(ngb_pid.west, HALO_TAG_WE, &data[halo_chunk_start_index.west],
+                   halo_chunk_size.west);
+    if (ngb_pid.east != EMPTY)
+        threadRecv(ngb_pid.east, HALO_TAG_WE, &data[halo_chunk_start_index.east],
+                   halo_chunk_size.east);
+    if (ngb_pid.south != EMPTY)
+        threadRecv(ngb_pid.south, HALO_TAG_SN, &data[halo_chunk_start_index.south],
+                   halo_chunk_size.south);
+    if (ngb_pid.north != EMPTY)
+        threadRecv(ngb_pid.north, HALO_TAG_SN, &data[halo_chunk_start_index.north],
+                   halo_chunk_size.north);
+#elif !defined(USE_MPI)
+    // no need to communicate in a non-MPI code
+    return;
+#else
+    halo_plan.finish();
+#endif
+}
 
-    // Assemble send buffers to south
-    if (ngb_pid.south != EMPTY) {
-        for(int n = 0; n < halo_chunk_size.south; ++n) {
-            snd_buf_sn[n] = data[on_boarder_ids.south[n]];
-        }
-        MPI_Send(snd_buf_sn.data(), snd_buf_sn.size(), MPI_DOUBLE, ngb_pid.south, tag_sn, MPI_COMM_WORLD);
-    }
+#ifdef USE_THREADS
+void Vector::sendHalo(int dest, int tag, const vector<int> &ids) {
 
-    // Receive from east
-    if (ngb_pid.east != EMPTY) {
-        MPI_Recv(rcv_buf_we.data(), rcv_buf_we.size(), MPI_DOUBLE, ngb_pid.east, tag_we, MPI_COMM_WORLD, &status);
-        int id = halo_chunk_start_index.east;
-        for(int n = 0; n < halo_chunk_size.east; ++n) {
-            data[id + n] = rcv_buf_we[n];
-        }
-    }
+    vector<double> buffer(ids.size());
 
-    // Receive from north
-    if (ngb_pid.north != EMPTY) {
-        MPI_Recv(rcv_buf_sn.data(), rcv_buf_sn.size(), MPI_DOUBLE, ngb_pid.north, tag_sn, MPI_COMM_WORLD, &status);
-        int id = halo_chunk_start_index.north;
-        for(int n = 0; n < halo_chunk_size.north; ++n) {
-            data[id + n] = rcv_buf_sn[n];
-        }
-    }
-    /* ****************************************************************************************** */
-    /* ****************************************************************************************** */
-    // Assemble send buffers to east
-    if (ngb_pid.east != EMPTY) {
-        for(int n = 0; n < halo_chunk_size.east; ++n) {
-            snd_buf_we[n] = data[on_boarder_ids.east[n]];
-        }
-        MPI_Send(snd_buf_we.data(), snd_buf_we.size(), MPI_DOUBLE, ngb_pid.east, tag_we, MPI_COMM_WORLD);
-    }
+    for(size_t n = 0; n < ids.size(); ++n)
+        buffer[n] = data[ids[n]];
+    threadSend(dest, tag, buffer.data(), buffer.size());
+}
+#endif
 
-    // Assemble send buffers to north
-    if (ngb_pid.north != EMPTY) {
-        for(int n = 0; n < halo_chunk_size.north; ++n) {
-            snd_buf_sn[n] = data[on_boarder_ids.north[n]];
-        }
-        MPI_Send(snd_buf_sn.data(), snd_buf_sn.size(), MPI_DOUBLE, ngb_pid.north, tag_sn, MPI_COMM_WORLD);
-    }
+void Vector::buildHaloPlan() {
 
-    // Receive from west
-    if (ngb_pid.west != EMPTY) {
-        MPI_Recv(rcv_buf_we.data(), rcv_buf_we.size(), MPI_DOUBLE, ngb_pid.west, tag_we, MPI_COMM_WORLD, &status);
-        int id = halo_chunk_start_index.west;
-        for(int n = 0; n < halo_chunk_size.west; ++n) {
-            data[id + n] = rcv_buf_we[n];
-        }
-    }
+    Neighbors ngb_pid = dims.getDecomposition().getNgbPid();
+    halo_plan.clear();
 
-    // Receive from south
-    if (ngb_pid.south != EMPTY) {
-        MPI_Recv(rcv_buf_sn.data(), rcv_buf_sn.size(), MPI_DOUBLE, ngb_pid.south, tag_sn, MPI_COMM_WORLD, &status);
-        int id = halo_chunk_start_index.south;
-        for(int n = 0; n < halo_chunk_size.south; ++n) {
-            data[id + n] = rcv_buf_sn[n];
-        }
-    }
-    /* ****************************************************************************************** */
+    if (ngb_pid.west != EMPTY)
+        halo_plan.addNeighbor(HALO_DIR_WEST, ngb_pid.west, HALO_TAG_WE, on_boarder_ids.west,
+                              halo_chunk_start_index.west, halo_chunk_size.west);
+    if (ngb_pid.east != EMPTY)
+        halo_plan.addNeighbor(HALO_DIR_EAST, ngb_pid.east, HALO_TAG_WE, on_boarder_ids.east,
+                              halo_chunk_start_index.east, halo_chunk_size.east);
+    if (ngb_pid.south != EMPTY)
+        halo_plan.addNeighbor(HALO_DIR_SOUTH, ngb_pid.south, HALO_TAG_SN, on_boarder_ids.south,
+                              halo_chunk_start_index.south, halo_chunk_size.south);
+    if (ngb_pid.north != EMPTY)
+        halo_plan.addNeighbor(HALO_DIR_NORTH, ngb_pid.north, HALO_TAG_SN, on_boarder_ids.north,
+                              halo_chunk_start_index.north, halo_chunk_size.north);
 
-    MPI_Barrier(MPI_COMM_WORLD);
-#endif
+    halo_plan.commit(dims.getDecomposition(), data.data());
 }
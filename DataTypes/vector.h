@@ -36,6 +36,7 @@
 #include "../General/dimensions.h"
 #include "../General/structs.h"
 #include "matrix.h"
+#include "halo_plan.h"
 
 using namespace std;
 
@@ -55,6 +56,8 @@ struct vector_ngb_ids {
  * The vector can be local or distributed.
  */
 class Vector : public Matrix {
+    friend class AsyncHalo;
+
     // already have # of real elements and # of halo elements
     Neighbors halo_chunk_size;              // Number of halo elements in each
                                             // direction
@@ -63,6 +66,8 @@ class Vector : public Matrix {
     vector_ngb_ids on_boarder_ids;          // IndicesBegEnd of on-boarder elements
                                             // that should be sent to neighboring
                                             // processes
+    HaloPlan halo_plan;                     // Persistent plan of the halo exchange,
+                                            // bound to the storage of the vector
 
 public:
     /*!
@@ -98,6 +103,37 @@ public:
      */
     void exchangeRealHalo();
 
+    /*!
+     * @brief Start the transfer of the data from the real cells of the local
+     *        process to the halo cells of the remote process.
+     * The on-border elements are sent in place, so they shouldn't be modified
+     * and the halo elements shouldn't be accessed until finishHaloExchange()
+     * is called. Other real elements can be modified meanwhile.
+     */
+    void startHaloExchange();
+
+    /*!
+     * @brief Complete the transfer started by startHaloExchange().
+     */
+    void finishHaloExchange();
+
+    /*!
+     * @brief Set the precision of the following halo exchanges.
+     * @param precision [in] One of PRECISION_* (see macro.h)
+     */
+    inline void setHaloPrecision(int precision) {
+        halo_plan.setPrecision(precision);
+    }
+
+    /*!
+     * @brief Swap the elements with another vector of the same layout.
+     * @param other [in/out] Vector to swap the elements with
+     */
+    inline void swapData(Vector &other) {
+        data.swap(other.data);
+        halo_plan.swap(other.halo_plan);
+    }
+
 private:
     /*!
      * @brief Calculate chunk size and its starting index for the halo elements.
@@ -108,6 +144,21 @@ private:
      */
     void associateChunkData(const int num_elts, int &_halo_start_index,
                             int &_chunk_size, int &_chunk_start_index);
+
+    /*!
+     * @brief Build the persistent plan of the halo exchange.
+     */
+    void buildHaloPlan();
+
+#ifdef USE_THREADS
+    /*!
+     * @brief Send the on-border elements to the neighbor through its mailbox.
+     * @param dest [in] Rank of the neighbor
+     * @param tag [in] Tag of the message
+     * @param ids [in] IDs of the elements to send
+     */
+    void sendHalo(int dest, int tag, const vector<int> &ids);
+#endif
 };
 
 #endif
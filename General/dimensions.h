@@ -65,6 +65,24 @@ public:
         dy = L / elts_glob.j;
     }
 
+    /*!
+     * @brief Set the way the halos are exchanged, should be called before
+     *        the domain is decomposed.
+     * @param type [in] One of HALO_* (see macro.h)
+     */
+    inline void setHaloComm(int type) {
+        decomp.setHaloComm(type);
+    }
+
+    /*!
+     * @brief Set the relative throughput of the local process, should be
+     *        called before the domain is decomposed.
+     * @param weight [in] Positive weight, 1 by default
+     */
+    inline void setWeight(double weight) {
+        decomp.setWeight(weight);
+    }
+
     /*!
      * @brief Decompose the domain.
      * @param num_procs_i Number of processes in i-th direction.
@@ -78,6 +96,16 @@ public:
         return exit_code;
     }
 
+    /*!
+     * @brief Split every sub-domain into a grid of blocks, should be called
+     *        after the domain is decomposed.
+     * @param blocks_per_proc Number of blocks of every sub-domain.
+     * @return EXIT_FAILURE if a sub-domain is too small, EXIT_SUCCESS otherwise.
+     */
+    inline int decomposeBlocks(int blocks_per_proc) {
+        return decomp.decomposeBlocks(blocks_per_proc, elts_glob, elts_loc);
+    }
+
     /* ************************************************* */
     /* ******************** Getters ******************** */
     /* ************************************************* */
@@ -29,64 +29,199 @@
 #include <iostream>
 #include <cstdlib>
 #include <string>
+#include <fstream>
+#include <vector>
+#include <algorithm>
 #include "helpers.h"
 #include "structs.h"
 #include "../MPI/common.h"
 
 using namespace std;
 
-void Helpers::setDimensionsAndDecompose(int argc, char** argv, Dimensions &dims) {
+void Helpers::setDimensionsAndDecompose(int argc, char** argv, Dimensions &dims,
+                                        SolverSettings &settings) {
 
     IndicesIJ elts_glob;    // Number of global cells in each direction
     IndicesIJ num_procs;    // Number of processes in each direction
+    int halo_comm;          // Way the halos are exchanged
+    string profile;         // Source of the weights of the processes
 
-    parseInput(argc, argv, elts_glob, num_procs);
+    parseInput(argc, argv, elts_glob, num_procs, halo_comm, profile, settings);
+
+#ifdef USE_THREADS
+    /* These solvers rely on the MPI communicators, the ranks of the threads have none. */
+    if (getNumProcs() > 1 && (settings.type == SOLVER_LINE_JACOBI || settings.type == SOLVER_ASYNC
+                              || settings.balance_interval > 0)) {
+        printByRoot("Error! The chosen solver is not supported when the processes are threads.");
+        terminateExecution();
+    }
+#endif
+
+    /* Without -d the grid of processes is chosen to minimize the halos. */
+    if (num_procs.i == 0) {
+        num_procs = Decomposition::findProcessGrid(getNumProcs(), elts_glob);
+        printByRoot("Decomposition: " + std::to_string(num_procs.i) + " x "
+                    + std::to_string(num_procs.j));
+    }
 
     /* Decompose the domain and assign local Dimensions */
     dims.setNumEltsGlob(elts_glob);
+    dims.setHaloComm(halo_comm);
+    if (profile == "auto")
+        dims.setWeight(calibrateWeight());
+    else if (!profile.empty())
+        dims.setWeight(readWeight(profile));
     if (dims.decompose(num_procs) == EXIT_FAILURE) {
         terminateExecution();
     }
+    if (settings.num_blocks > 1 && dims.decomposeBlocks(settings.num_blocks) == EXIT_FAILURE) {
+        terminateExecution();
+    }
 
 }
 
-void Helpers::parseInput(int argc, char** argv, IndicesIJ &elts_glob, IndicesIJ &num_procs) {
+void Helpers::parseInput(int argc, char** argv, IndicesIJ &elts_glob, IndicesIJ &num_procs,
+                         int &halo_comm, string &profile, SolverSettings &settings) {
 
     /* Assign the default values first. */
     elts_glob.i = elts_glob.j = 10;
-    num_procs.i = num_procs.j = 1;
+    num_procs.i = num_procs.j = 0;     // Chosen automatically
+    halo_comm = HALO_P2P;
+    profile = "";
 
-    if (argc > 1 && argc != 7) {
-        terminateDueToParserFailure();
-    }
-    else if (argc == 7) {
-        int position_s = 1;
-        int position_p = 4;
+    /* Keys may come in any order, each key is followed by its values. */
+    for(int n = 1; n < argc; ++n) {
+        string key = string(argv[n]);
 
-        /* Check the first key and assume the position of the second one */
-        if (string(argv[1]) == "-s") {
-            position_s = 1;
-            position_p = 4;
+        if (key == "-s" && n + 2 < argc) {
+            elts_glob.i = atoi(argv[n + 1]);
+            elts_glob.j = atoi(argv[n + 2]);
+            n += 2;
         }
-        else if (string(argv[1]) == "-d") {
-            position_s = 4;
-            position_p = 1;
+        else if (key == "-d" && n + 2 < argc) {
+            num_procs.i = atoi(argv[n + 1]);
+            num_procs.j = atoi(argv[n + 2]);
+            if (num_procs.i < 1 || num_procs.j < 1)
+                terminateDueToParserFailure();
+            n += 2;
         }
-
-        /* Check that all keys are correct */
-        if (std::string(argv[position_s]) != "-s") {
-            terminateDueToParserFailure();
+        else if (key == "-c" && n + 1 < argc) {
+            string comm = string(argv[n + 1]);
+            if (comm == "p2p")
+                halo_comm = HALO_P2P;
+            else if (comm == "neighbor")
+                halo_comm = HALO_NEIGHBOR;
+            else if (comm == "shared")
+                halo_comm = HALO_SHARED;
+            else if (comm == "rma")
+                halo_comm = HALO_RMA;
+            else
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-m" && n + 1 < argc) {
+            string solver = string(argv[n + 1]);
+            if (solver == "jacobi")
+                settings.type = SOLVER_JACOBI;
+            else if (solver == "line")
+                settings.type = SOLVER_LINE_JACOBI;
+            else if (solver == "sor")
+                settings.type = SOLVER_SOR;
+            else if (solver == "async")
+                settings.type = SOLVER_ASYNC;
+            else if (solver == "schwarz")
+                settings.type = SOLVER_SCHWARZ;
+            else if (solver == "direct")
+                settings.type = SOLVER_DIRECT;
+            else
+                terminateDueToParserFailure();
+            n += 1;
         }
-        if (std::string(argv[position_p]) != "-d") {
+        else if (key == "-w" && n + 1 < argc) {
+            char *end = nullptr;
+            if (string(argv[n + 1]) == "auto") {
+                settings.adaptive_omega = true;
+            }
+            else {
+                settings.omega = strtod(argv[n + 1], &end);
+                if (end == argv[n + 1] || *end != '\0')
+                    terminateDueToParserFailure();
+            }
+            if (settings.omega < 0.0 || settings.omega >= 2.0)
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-a" && n + 1 < argc) {
+            settings.anderson_depth = atoi(argv[n + 1]);
+            if (settings.anderson_depth < 0)
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-p" && n + 1 < argc) {
+            profile = string(argv[n + 1]);
+            n += 1;
+        }
+        else if (key == "-k" && n + 1 < argc) {
+            settings.halo_depth = atoi(argv[n + 1]);
+            if (settings.halo_depth < 1)
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-b" && n + 1 < argc) {
+            settings.balance_interval = atoi(argv[n + 1]);
+            if (settings.balance_interval < 0)
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-f" && n + 1 < argc) {
+            string precision = string(argv[n + 1]);
+            if (precision == "double")
+                settings.halo_precision = PRECISION_DOUBLE;
+            else if (precision == "float")
+                settings.halo_precision = PRECISION_FLOAT;
+            else if (precision == "delta")
+                settings.halo_precision = PRECISION_DELTA;
+            else
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-r" && n + 1 < argc) {
+            string reduction = string(argv[n + 1]);
+            if (reduction == "blocking")
+                settings.reduction = REDUCTION_BLOCKING;
+            else if (reduction == "overlap")
+                settings.reduction = REDUCTION_OVERLAP;
+            else if (reduction == "node")
+                settings.reduction = REDUCTION_NODE;
+            else
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-g" && n + 1 < argc) {
+            settings.graph_sweeps = atoi(argv[n + 1]);
+            if (settings.graph_sweeps < 1)
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-t" && n + 1 < argc) {
+            string comm_thread = string(argv[n + 1]);
+            if (comm_thread == "master")
+                settings.comm_thread = COMM_MASTER;
+            else if (comm_thread == "dedicated")
+                settings.comm_thread = COMM_DEDICATED;
+            else
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else if (key == "-o" && n + 1 < argc) {
+            settings.num_blocks = atoi(argv[n + 1]);
+            if (settings.num_blocks < 1)
+                terminateDueToParserFailure();
+            n += 1;
+        }
+        else {
             terminateDueToParserFailure();
         }
-
-        /* Read the values */
-        elts_glob.i = atoi(argv[position_s + 1]);
-        elts_glob.j = atoi(argv[position_s + 2]);
-
-        num_procs.i = atoi(argv[position_p + 1]);
-        num_procs.j = atoi(argv[position_p + 2]);
     }
 }
 
@@ -94,9 +229,43 @@ void Helpers::terminateDueToParserFailure() {
     printByRoot("\nError! Incorrect arguments were passed to the command line.\n"
                 "Use the following keys:\n"
                 "  -s - set number of the grid cells in each direction (i j)\n"
-                "  -d - set decomposition for each direction (i j)\n"
+                "  -d - set decomposition for each direction (i j), by default\n"
+                "       it is chosen to minimize the number of halo cells\n"
+                "  -c - set the halo exchange: p2p (default, point-to-point),\n"
+                "       neighbor (neighborhood collective), shared (shared\n"
+                "       memory within a node, point-to-point between nodes)\n"
+                "       or rma (one-sided puts)\n"
+                "  -m - set the solver: jacobi (default), line (alternating\n"
+                "       direction line Jacobi), sor (red-black SOR), async\n"
+                "       (asynchronous relaxation), schwarz (restricted\n"
+                "       additive Schwarz) or direct (banded Cholesky)\n"
+                "  -w - set the relaxation factor or 'auto' to tune it during\n"
+                "       the solve\n"
+                "  -a - accelerate the solver with Anderson acceleration using\n"
+                "       the given number of previous iterates\n"
+                "  -k - set the depth of the halo of the Jacobi method, it is\n"
+                "       exchanged once per the given number of iterations\n"
+                "  -p - weigh the sub-domains by the throughput of the processes:\n"
+                "       a file with one weight per rank and line, or 'auto' to\n"
+                "       measure it at startup\n"
+                "  -b - check the load balance every given number of iterations\n"
+                "       and move the cut lines if it is needed\n"
+                "  -o - split every sub-domain of the Jacobi method into the\n"
+                "       given number of blocks, updated as OpenMP tasks\n"
+                "  -g - run the given number of sweeps of the blocks (see -o)\n"
+                "       as one graph of OpenMP tasks, without barriers between\n"
+                "       the sweeps; the convergence is checked after the graph\n"
+                "  -f - set the precision of the halos until the residual\n"
+                "       approaches the tolerance: double (default), float or\n"
+                "       delta (changes since the previous exchange as float)\n"
+                "  -r - set the reduction of the residual norm: blocking\n"
+                "       (default), overlap (with the next sweep) or node\n"
+                "       (overlapped, within the nodes first)\n"
+                "  -t - set the thread driving the communication of the hybrid\n"
+                "       runs: master (default, the other threads wait for the\n"
+                "       halos) or dedicated (the other threads keep computing)\n"
                 "Example:\n"
-                "  ./a.out -s 10 10 -d 1 1");
+                "  ./a.out -s 10 10 -d 1 1 -m sor -w auto");
     terminateExecution();
 }
 
@@ -131,4 +300,66 @@ double Helpers::toc() {
 #endif
 
     return current_time;
-}
\ No newline at end of file
+}
+
+double Helpers::readWeight(const string &file_name) {
+
+    ifstream file(file_name);
+    double weight = 0.0;
+    int my_rank = getMyRank();
+
+    for(int n = 0; n <= my_rank && file; ++n) {
+        file >> weight;
+    }
+
+    if (!file || weight <= 0.0) {
+        cout << "Error! The profile " << file_name << " has no positive weight for process "
+             << my_rank << "." << endl;
+        terminateExecution();
+    }
+
+    return weight;
+}
+
+double Helpers::calibrateWeight() {
+
+    const int n = 256;              // Number of cells in each direction
+    const int num_sweeps = 20;
+    const int num_trials = 3;       // The fastest trial is taken, to skip the warm up
+    vector<double> x(n * n, 0.0), x_new(n * n, 0.0);
+    double best_time = 0.0;
+
+    for(int trial = 0; trial < num_trials; ++trial) {
+        double time = 0.0;
+#ifdef USE_MPI
+        time = MPI_Wtime();
+#else
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        time = (double)tv.tv_sec + 1.0e-6 * (double) tv.tv_usec;
+#endif
+        for(int s = 0; s < num_sweeps; ++s) {
+            for(int i = 1; i < n - 1; ++i) {
+                for(int j = 1; j < n - 1; ++j) {
+                    int k = j + i * n;
+                    x_new[k] = 0.25 * (1.0 + x[k - n] + x[k + n] + x[k - 1] + x[k + 1]);
+                }
+            }
+            x.swap(x_new);
+        }
+#ifdef USE_MPI
+        time = MPI_Wtime() - time;
+#else
+        gettimeofday(&tv, NULL);
+        time = (double)tv.tv_sec + 1.0e-6 * (double) tv.tv_usec - time;
+#endif
+        if (trial == 0 || time < best_time)
+            best_time = time;
+    }
+
+    /* The result is used, so the sweeps are not optimized away. */
+    if (x[n + 1] < 0.0)
+        best_time *= 2.0;
+
+    return num_sweeps * (n - 2) * (n - 2) * 1e-6 / max(best_time, 1e-9);
+}
@@ -29,6 +29,7 @@
 #ifndef HELPERS_H_
 #define HELPERS_H_
 
+#include <string>
 #include "dimensions.h"
 
 class Helpers {
@@ -43,8 +44,10 @@ public:
      * @param argc [in] Number of command line arguments
      * @param argv [in] Vector of command line arguments
      * @param dims [out] Structure with Dimensions of the domain
+     * @param settings [out] Settings of the solver
      */
-    void setDimensionsAndDecompose(int argc, char** argv, Dimensions &dims);
+    void setDimensionsAndDecompose(int argc, char** argv, Dimensions &dims,
+                                   SolverSettings &settings);
 
     /*!
      * @brief Start the timer and return the current time (in seconds) starting
@@ -64,14 +67,34 @@ public:
      * @param argv CL parameters.
      * @param elts_glob Number of global elements in each direction.
      * @param num_procs Number of local elements in each direction.
+     * @param halo_comm Way the halos are exchanged (see HALO_* in macro.h).
+     * @param profile Source of the weights of the processes: file name,
+     *        "auto" for the calibration or empty for equal weights.
+     * @param settings Settings of the solver.
      */
-    void parseInput(int argc, char** argv, IndicesIJ &elts_glob, IndicesIJ &num_procs);
+    void parseInput(int argc, char** argv, IndicesIJ &elts_glob, IndicesIJ &num_procs,
+                    int &halo_comm, std::string &profile, SolverSettings &settings);
 
 private:
     /*!
      * @brief Terminate execution due to error in the input parameters.
      */
     void terminateDueToParserFailure();
+
+    /*!
+     * @brief Read the weight of the local process from the profile.
+     * The file holds one weight per line, in the order of the ranks.
+     * @param file_name [in] Name of the profile
+     * @return Weight of the local process.
+     */
+    double readWeight(const std::string &file_name);
+
+    /*!
+     * @brief Measure the throughput of the local process with a few Jacobi
+     *        sweeps over a fixed grid.
+     * @return Number of updated cells per microsecond.
+     */
+    double calibrateWeight();
 };
 
 #endif /* HELPERS_H_ */
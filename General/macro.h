@@ -35,6 +35,39 @@ enum {
     IO_BY_COLLECTIVE,
 };
 
+enum {
+    HALO_P2P,
+    HALO_NEIGHBOR,
+    HALO_SHARED,
+    HALO_RMA,
+};
+
+enum {
+    PRECISION_DOUBLE,
+    PRECISION_FLOAT,
+    PRECISION_DELTA,
+};
+
+enum {
+    REDUCTION_BLOCKING,
+    REDUCTION_OVERLAP,
+    REDUCTION_NODE,
+};
+
+enum {
+    COMM_MASTER,
+    COMM_DEDICATED,
+};
+
+enum {
+    SOLVER_JACOBI,
+    SOLVER_LINE_JACOBI,
+    SOLVER_SOR,
+    SOLVER_ASYNC,
+    SOLVER_SCHWARZ,
+    SOLVER_DIRECT,
+};
+
 #define NOT_IMPLEMENTED { std::cerr << "Error! The " << __FUNCTION__ << " function is not implemented. See file " \
                                     << __FILE__ << ":" << __LINE__ << ".\n"; terminateExecution(); }
 
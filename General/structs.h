@@ -68,4 +68,29 @@ struct Neighbors {
     int north = EMPTY;
     int central = EMPTY;
 };
+
+/*!
+ * @brief Structure of the solver settings.
+ * Filled from the command line and passed to the \e Solver.
+ */
+struct SolverSettings {
+    int type = SOLVER_JACOBI;   // Type of the solver (see SOLVER_* in macro.h)
+    int max_iter = 10000;       // Maximum number of iterations
+    double tolerance = 1e-6;    // Stopping criteria
+    double omega = 0.0;         // Relaxation factor (0 selects the default of the solver)
+    bool adaptive_omega = false;// Tune the relaxation factor during the solve
+    int anderson_depth = 0;     // Number of iterates used by Anderson acceleration (0 disables it)
+    int halo_depth = 1;         // Number of halo layers of the Jacobi method, exchanged once
+                                // per this number of iterations
+    int balance_interval = 0;   // Number of iterations between the checks of the load
+                                // balance (0 disables dynamic balancing)
+    int num_blocks = 1;         // Number of blocks of every sub-domain of the Jacobi method
+    int graph_sweeps = 1;       // Number of sweeps of the blocks run as one graph of tasks
+    int halo_precision = PRECISION_DOUBLE;  // Precision of the halos far from convergence
+                                            // (see PRECISION_* in macro.h)
+    int reduction = REDUCTION_BLOCKING;     // Global reduction of the residual norm
+                                            // (see REDUCTION_* in macro.h)
+    int comm_thread = COMM_MASTER;          // Thread driving the halo exchange and the
+                                            // reductions (see COMM_* in macro.h)
+};
 #endif
@@ -26,6 +26,8 @@
 #ifdef USE_MPI
 #include <mpi.h>
 #endif
+#include <cstdlib>
+#include <iostream>
 
 /*!
  * @brief Terminate the program.
@@ -33,6 +35,10 @@
 inline void terminateExecution() {
 #ifdef USE_MPI
     MPI_Abort(MPI_COMM_WORLD, 1);
+#elif defined(USE_THREADS)
+    /* The other ranks are still running, so the static objects are left alone. */
+    std::cout << std::flush;
+    std::_Exit(1);
 #else
     exit(1);
 #endif
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file thread_pool.cpp
+ * @brief Contains definitions of methods from the \e ThreadPool class.
+ */
+
+#ifdef USE_POOL
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "thread_pool.h"
+
+ThreadPool &ThreadPool::getInstance() {
+
+    static ThreadPool pool;
+    return pool;
+}
+
+ThreadPool::ThreadPool() : num_workers(0), pending(0), queued(0), stop(false) {
+
+    std::vector<int> cores;         // Cores the process may run on
+    const char *env = getenv("POOL_NUM_THREADS");
+
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for(int c = 0; c < CPU_SETSIZE; ++c) {
+            if (CPU_ISSET(c, &mask))
+                cores.push_back(c);
+        }
+    }
+#endif
+
+    if (env != nullptr && atoi(env) > 0)
+        num_workers = atoi(env) - 1;
+    else if (!cores.empty())
+        num_workers = cores.size() - 1;
+    else
+        num_workers = std::thread::hardware_concurrency() - 1;
+    if (num_workers < 0)
+        num_workers = 0;
+
+    workers.reset(new Worker[num_workers]);
+    for(int w = 0; w < num_workers; ++w) {
+        workers[w].thread = std::thread(&ThreadPool::run, this, w);
+
+#ifdef __linux__
+        /* The calling thread stays on the first core, the workers take the next ones. */
+        if (!cores.empty()) {
+            cpu_set_t core;
+            CPU_ZERO(&core);
+            CPU_SET(cores[(w + 1) % cores.size()], &core);
+            pthread_setaffinity_np(workers[w].thread.native_handle(), sizeof(core), &core);
+        }
+#endif
+    }
+}
+
+ThreadPool::~ThreadPool() {
+
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        stop = true;
+    }
+    idle.notify_all();
+
+    for(int w = 0; w < num_workers; ++w)
+        workers[w].thread.join();
+}
+
+void ThreadPool::submit(int home, int num_tasks, std::function<void()> task) {
+
+    if (num_workers == 0) {
+        task();
+        return;
+    }
+
+    /* Neighboring tasks go to the same or neighboring workers, which share the caches. */
+    Worker &worker = workers[(long)home * num_workers / num_tasks];
+
+    ++pending;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        ++queued;
+    }
+    idle.notify_one();
+}
+
+void ThreadPool::wait() {
+
+    std::function<void()> task;
+
+    while (pending > 0) {
+        if (findTask(-1, task)) {
+            execute(task);
+        }
+        else {
+            std::unique_lock<std::mutex> lock(idle_mutex);
+            done.wait(lock, [&]() { return pending == 0 || queued > 0; });
+        }
+    }
+}
+
+void ThreadPool::parallelFor(int beg, int end, const std::function<void(int, int)> &body) {
+
+    int num_chunks = std::min(getNumThreads(), end - beg);
+
+    for(int c = 0; c < num_chunks; ++c) {
+        int chunk_beg = beg + (long)(end - beg) * c / num_chunks;
+        int chunk_end = beg + (long)(end - beg) * (c + 1) / num_chunks;
+        submit(c, num_chunks, [=, &body]() { body(chunk_beg, chunk_end); });
+    }
+    wait();
+}
+
+void ThreadPool::run(int w) {
+
+    std::function<void()> task;
+
+    while (true) {
+        if (findTask(w, task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle.wait(lock, [&]() { return stop || queued > 0; });
+        if (stop && queued == 0)
+            return;
+    }
+}
+
+bool ThreadPool::findTask(int w, std::function<void()> &task) {
+
+    /* The own deque is used as a stack, the latest task is the hottest in the cache. */
+    if (w >= 0) {
+        Worker &worker = workers[w];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (!worker.tasks.empty()) {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+
+    /* Victims are tried by the distance, the calling thread is next to worker 0. */
+    for(int d = 1; d <= num_workers; ++d) {
+        for(int v : {w - d, w + d}) {
+            if (v < 0 || v >= num_workers)
+                continue;
+            Worker &victim = workers[v];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                --queued;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::execute(std::function<void()> &task) {
+
+    task();
+    task = nullptr;
+
+    if (--pending == 0) {
+        std::lock_guard<std::mutex> lock(idle_mutex);
+        done.notify_all();
+    }
+}
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file thread_pool.h
+ * @brief Contains declaration of the \e ThreadPool class.
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#ifdef USE_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/*!
+ * @class ThreadPool
+ * @brief Work-stealing pool of threads, an alternative to OpenMP.
+ *
+ * Every worker is pinned to one of the cores the process may run on and owns
+ * a deque of tasks. The owner takes the latest task from the back of its
+ * deque, while an idle worker steals the oldest one from the front of the
+ * deque of another worker, trying the workers on the nearest cores first.
+ * The calling thread doesn't have to be idle either: it executes tasks while
+ * it waits for them.
+ *
+ * The pool is created on the first use and kept until the end of the
+ * program, so the threads are reused by all solver calls.
+ */
+class ThreadPool {
+
+    /* Thread of the pool with its tasks */
+    struct Worker {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::thread thread;
+    };
+
+    std::unique_ptr<Worker[]> workers;
+    int num_workers;                // Number of threads of the pool, without the calling one
+    std::atomic<int> pending;       // Tasks submitted and not finished yet
+    std::atomic<int> queued;        // Tasks waiting in the deques
+    std::mutex idle_mutex;
+    std::condition_variable idle;   // Wakes up the workers when there are tasks
+    std::condition_variable done;   // Wakes up the calling thread
+    bool stop;                      // True when the pool is destroyed
+
+public:
+    /*!
+     * @brief Return the pool, create it on the first call.
+     * The number of threads (including the calling one) is given by the
+     * POOL_NUM_THREADS environment variable, by default it is the number of
+     * cores available to the process.
+     */
+    static ThreadPool &getInstance();
+
+    /*!
+     * @brief Submit the task.
+     * @param home [in] Index of the task used to choose its worker, tasks with
+     *        close indices go to the same or neighboring workers
+     * @param num_tasks [in] Number of tasks the index is counted in
+     * @param task [in] The task
+     */
+    void submit(int home, int num_tasks, std::function<void()> task);
+
+    /*!
+     * @brief Execute the submitted tasks until all of them are finished.
+     */
+    void wait();
+
+    /*!
+     * @brief Split the range into one chunk per thread and process the chunks
+     *        as tasks.
+     * @param beg [in] Beginning of the range
+     * @param end [in] End of the range (not included)
+     * @param body [in] Function processing the chunk [beg, end)
+     */
+    void parallelFor(int beg, int end, const std::function<void(int, int)> &body);
+
+    /*!
+     * @brief Return the number of threads, including the calling one.
+     */
+    inline int getNumThreads() const { return num_workers + 1; }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+private:
+    /*!
+     * @brief Create the workers and pin them to the cores.
+     */
+    ThreadPool();
+
+    /*!
+     * @brief Finish the workers.
+     */
+    ~ThreadPool();
+
+    /*!
+     * @brief Main loop of the worker.
+     * @param w [in] Index of the worker
+     */
+    void run(int w);
+
+    /*!
+     * @brief Take a task from the own deque or steal one, the deques of the
+     *        nearest workers are tried first.
+     * @param w [in] Index of the worker, -1 for the calling thread
+     * @param task [out] The task
+     * @return True if a task has been found.
+     */
+    bool findTask(int w, std::function<void()> &task);
+
+    /*!
+     * @brief Execute the task and report its completion.
+     * @param task [in] The task
+     */
+    void execute(std::function<void()> &task);
+};
+
+#endif
+#endif /* THREAD_POOL_H_ */
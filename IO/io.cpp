@@ -27,6 +27,8 @@
 
 #include <fstream>
 #include "io.h"
+#include "../MPI/threads.h"
+#include "../General/thread_pool.h"
 
 // Writes data into the file
 void IO::writeFile(std::string file_name, Dimensions &dims, Field &T) {
@@ -34,19 +36,30 @@ void IO::writeFile(std::string file_name, Dimensions &dims, Field &T) {
     printByRoot("Writing results to file: " + file_name);
 
 #ifndef USE_MPI
-    ofstream out;
+    int start_i = dims.getBegIndicesGlob().i;
+    int start_j = dims.getBegIndicesGlob().j;
 
-    out.open(file_name);
+    /* Ranks running as threads share the file, so they append their parts in turn. */
+    for(int pid = 0; pid < getNumProcs(); ++pid) {
+        if (pid == getMyRank()) {
+            ofstream out;
 
-    for(int i = 0; i < T.numRows(); ++i) {
-        for(int j = 0; j < T.numCols(); ++j) {
-            out << dims.getDx() * i + 0.5 * dims.getDx() << " "
-                << dims.getDy() * j + 0.5 * dims.getDy() << " "
-                << T(i, j) << "\n";
+            out.open(file_name, (pid == 0) ? ios::trunc : ios::app);
+
+            for(int i = 0; i < T.numRows(); ++i) {
+                for(int j = 0; j < T.numCols(); ++j) {
+                    out << dims.getDx() * (i + start_i) + 0.5 * dims.getDx() << " "
+                        << dims.getDy() * (j + start_j) + 0.5 * dims.getDy() << " "
+                        << T(i, j) << "\n";
+                }
+            }
+
+            out.close();
         }
+#ifdef USE_THREADS
+        threadBarrier();
+#endif
     }
-
-    out.close();
 #else
     MPI_File mpi_file;
     int out_case = IO_BY_ROOT;
@@ -79,24 +92,42 @@ void IO::generateGrid(Dimensions &dims, Field &T, vector<double> &grid_1D) {
     // Assemble 1D array from the grid.
     int start_i = dims.getBegIndicesGlob().i;
     int start_j = dims.getBegIndicesGlob().j;
-    int counter = 0;
 
-    for(int i = 0; i < T.numRows(); ++i) {
-        for(int j = 0; j < T.numCols(); ++j) {
-            grid_1D[counter++] = dims.getDx() * (i + start_i) + 0.5 * dims.getDx();
-            grid_1D[counter++] = dims.getDy() * (j + start_j) + 0.5 * dims.getDy();
+    // Every row of the field has its own part of the array.
+    auto packRows = [&](int beg_i, int end_i) {
+        for(int i = beg_i; i < end_i; ++i) {
+            int counter = 2 * i * T.numCols();
+            for(int j = 0; j < T.numCols(); ++j) {
+                grid_1D[counter++] = dims.getDx() * (i + start_i) + 0.5 * dims.getDx();
+                grid_1D[counter++] = dims.getDy() * (j + start_j) + 0.5 * dims.getDy();
+            }
         }
-    }
+    };
+
+#ifdef USE_POOL
+    ThreadPool::getInstance().parallelFor(0, T.numRows(), packRows);
+#else
+    packRows(0, T.numRows());
+#endif
 }
 
 void IO::convertTo1D(Field &field_2D, vector<double> &field_1D) {
 
-    int counter = 0;
-    for(int i = 0; i < field_2D.numRows(); ++i) {
-        for(int j = 0; j < field_2D.numCols(); ++j) {
-            field_1D[counter++] = field_2D(i, j);
+    // Every row of the field has its own part of the array.
+    auto packRows = [&](int beg_i, int end_i) {
+        for(int i = beg_i; i < end_i; ++i) {
+            int counter = i * field_2D.numCols();
+            for(int j = 0; j < field_2D.numCols(); ++j) {
+                field_1D[counter++] = field_2D(i, j);
+            }
         }
-    }
+    };
+
+#ifdef USE_POOL
+    ThreadPool::getInstance().parallelFor(0, field_2D.numRows(), packRows);
+#else
+    packRows(0, field_2D.numRows());
+#endif
 }
 
 void IO::writeByRoot(MPI_File &mpi_file, Dimensions &dims, Field &T) {
@@ -26,11 +26,97 @@
  */
 
 #include "decomposition.h"
+#include "../threads.h"
+#include "../reduction.h"
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 using namespace std;
 
+#ifdef USE_MPI
+/*!
+ * @brief Free the communicator, unless MPI has been already finalized.
+ */
+static void freeCommunicator(MPI_Comm *comm) {
+
+    int finalized = 0;
+
+    MPI_Finalized(&finalized);
+    if (!finalized && *comm != MPI_COMM_NULL)
+        MPI_Comm_free(comm);
+    delete comm;
+}
+
+void Decomposition::createCommunicator(const IndicesIJ &elts_glob) {
+
+    int dims[2] = {num_subdomains.i, num_subdomains.j};
+    int periods[2] = {0, 0};
+    MPI_Comm ordered;
+    MPI_Comm *comm = new MPI_Comm;
+
+    /* Row-major enumeration of MPI matches the "natural" one: j + i * nj */
+    MPI_Comm_split(MPI_COMM_WORLD, 0, findNodeAwareRank(elts_glob), &ordered);
+    MPI_Cart_create(ordered, 2, dims, periods, 0, comm);
+    MPI_Comm_free(&ordered);
+    cart_comm = std::shared_ptr<MPI_Comm>(comm, freeCommunicator);
+
+    if (halo_comm == HALO_SHARED) {
+        MPI_Comm *shared = new MPI_Comm;
+        MPI_Comm_split_type(*cart_comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, shared);
+        node_comm = std::shared_ptr<MPI_Comm>(shared, freeCommunicator);
+    }
+}
+
+int Decomposition::findNodeAwareRank(const IndicesIJ &elts_glob) {
+
+    int my_rank = getMyRank();
+    int num_procs = getNumProcs();
+    int node_rank = 0;
+    int node_size = 0;
+    int leader = my_rank;           // World rank of the first process of the node
+    int num_nodes = 0;
+    int node = 0;                   // Index of the local node
+    MPI_Comm shared;
+    vector<int> leaders(num_procs);
+
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &shared);
+    MPI_Comm_rank(shared, &node_rank);
+    MPI_Comm_size(shared, &node_size);
+    MPI_Bcast(&leader, 1, MPI_INT, 0, shared);
+    MPI_Comm_free(&shared);
+
+    /* Nodes are enumerated in the order of their first processes. */
+    MPI_Allgather(&leader, 1, MPI_INT, leaders.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    for(int p = 0; p < num_procs; ++p) {
+        if (leaders[p] == p) {
+            if (p == leader)
+                node = num_nodes;
+            ++num_nodes;
+        }
+    }
+
+    /* Tiles need the same number of processes on every node. */
+    if (num_nodes == 1 || num_nodes * node_size != num_procs)
+        return my_rank;
+    for(int p = 0; p < num_procs; ++p) {
+        if (count(leaders.begin(), leaders.end(), leaders[p]) != node_size)
+            return my_rank;
+    }
+
+    IndicesIJ node_grid = findNodeGrid(num_nodes, num_subdomains, elts_glob);
+    if (node_grid.i == 0)
+        return my_rank;
+
+    /* Tile of the node, the processes of the node fill it row by row */
+    IndicesIJ tile(num_subdomains.i / node_grid.i, num_subdomains.j / node_grid.j);
+    int proc_ind_i = (node / node_grid.j) * tile.i + node_rank / tile.j;
+    int proc_ind_j = (node % node_grid.j) * tile.j + node_rank % tile.j;
+
+    return proc_ind_j + proc_ind_i * num_subdomains.j;
+}
+#endif
+
 int Decomposition::getProcCoord(int &proc_ind_i, int &proc_ind_j) {
 
     int my_rank = getMyRank();
@@ -43,6 +129,14 @@ int Decomposition::getProcCoord(int &proc_ind_i, int &proc_ind_j) {
         return EXIT_FAILURE;
     }
 
+#ifdef USE_MPI
+    /* The ranks may be reordered, so the position is known to the communicator only. */
+    int coords[2] = {0, 0};
+    MPI_Comm_rank(getCommunicator(), &my_rank);
+    MPI_Cart_coords(getCommunicator(), my_rank, 2, coords);
+    proc_ind_i = coords[0];
+    proc_ind_j = coords[1];
+#else
     /*
      * Note, according to the standard, C and C++ always round down results of
      * the integer division!
@@ -51,6 +145,7 @@ int Decomposition::getProcCoord(int &proc_ind_i, int &proc_ind_j) {
                                                             // in i-th direction
     proc_ind_j = my_rank - proc_ind_i * num_subdomains.j;   // index of the process
                                                             // in j-th direction
+#endif
 
     return EXIT_SUCCESS;
 }
@@ -80,9 +175,9 @@ int Decomposition::decompose(const IndicesIJ num_procs, const IndicesIJ elts_glo
     num_subdomains.i = num_procs.i;
     num_subdomains.j = num_procs.j;
 
-    /* Assign local Dimensions */
-    elts_loc.i = floor(elts_glob.i / num_subdomains.i);
-    elts_loc.j = floor(elts_glob.j / num_subdomains.j);
+#ifdef USE_MPI
+    createCommunicator(elts_glob);
+#endif
 
     /*
      * Assume that all processes are enumerated in the "natural" order. for a 2d
@@ -90,15 +185,15 @@ int Decomposition::decompose(const IndicesIJ num_procs, const IndicesIJ elts_glo
      *   2 5 8
      *   1 4 7
      *   0 3 6
-     * We need to ensure that processes at the most right column and the most top
-     * row have correct number of elements. This is important in situations, when
-     * the total number of elements in i-th or j-th directions are not divisible
-     * by the number of specified processes in the same direction. For instance,
+     * When the total number of elements in i-th or j-th directions is not
+     * divisible by the number of processes in the same direction, the remainder
+     * is spread one cell per process over the leading processes. For instance,
      * we have 3x3 decomposition (see above). Let's apply it to the domain of
-     * 10x10 elements. Thus, processes 0,1,3,4 should have 3x3 elements each,
-     * while processes 2 and 5 should have 3x4 elements, processes 6 and 7 should
-     * have 4x3 elements, and process 8 should have 4x4 elements. Summing up, all
-     * this processes will result in total number of 100 elements.
+     * 10x10 elements. Thus, process 0 has 4x4 elements, processes 1 and 2 have
+     * 4x3 elements, processes 3 and 6 have 3x4 elements and processes 4,5,7,8
+     * have 3x3 elements each. Summing up, all this processes will result in
+     * total number of 100 elements, and no process has more than one line of
+     * cells above the average in each direction.
      */
 
     /* Get process "coordinates". Note: my_rank = proc_ind_j + proc_ind_i * nj. */
@@ -107,30 +202,162 @@ int Decomposition::decompose(const IndicesIJ num_procs, const IndicesIJ elts_glo
     if (getProcCoord(proc_ind_i, proc_ind_j) == EXIT_FAILURE)
         return EXIT_FAILURE;
 
+    proc_ind.i = proc_ind_i;
+    proc_ind.j = proc_ind_j;
+
+    /* Weights of all processes, enumerated as the subdomains: j + i * nj */
+    vector<double> weights(num_procs_avail, weight);
+#ifdef USE_MPI
+    MPI_Allgather(&weight, 1, MPI_DOUBLE, weights.data(), 1, MPI_DOUBLE, getCommunicator());
+#elif defined(USE_THREADS)
+    /* Gather the weights by summing the vectors that hold only the own one. */
+    std::fill(weights.begin(), weights.end(), 0.0);
+    weights[getMyRank()] = weight;
+    threadAllreduce(weights.data(), num_procs_avail, REDUCE_SUM);
+#endif
+
+    /* Tensor-product partition: columns and rows get the sums of their weights */
+    vector<double> loads_i(num_subdomains.i, 0.0);
+    vector<double> loads_j(num_subdomains.j, 0.0);
+    for(int i = 0; i < num_subdomains.i; ++i) {
+        for(int j = 0; j < num_subdomains.j; ++j) {
+            loads_i[i] += weights[j + i * num_subdomains.j];
+            loads_j[j] += weights[j + i * num_subdomains.j];
+        }
+    }
+
     /*
-     * Get the global indices that correspond to the very first (bottom-left) cell
-     * of the current sub-domain.
+     * Assign local Dimensions and get the global indices that correspond to
+     * the very first (bottom-left) cell of the current sub-domain.
      */
-    beg_ind_glob.i = proc_ind_i * elts_loc.i;
-    beg_ind_glob.j = proc_ind_j * elts_loc.j;
+    splitCells(elts_glob.i, loads_i, proc_ind_i, elts_loc.i, beg_ind_glob.i);
+    splitCells(elts_glob.j, loads_j, proc_ind_j, elts_loc.j, beg_ind_glob.j);
+
+    findNeighborsIds();
+    checkForPhysicalBoundaries();
+
+    return EXIT_SUCCESS;
+}
 
-    /* Correct the number of cells */
-    if ((elts_glob.i % num_subdomains.i) && (proc_ind_i == num_subdomains.i - 1)) {
-        int remainder = elts_glob.i - elts_loc.i * (proc_ind_i + 1);
-        elts_loc.i += remainder;
+void Decomposition::splitCells(int num_cells, const vector<double> &loads, int part,
+                               int &size, int &beg) {
+
+    int num_parts = loads.size();
+    int assigned = 0;
+    double total = 0.0;
+    vector<int> sizes(num_parts, 0);
+    vector<double> fractions(num_parts, 0.0);
+
+    for(int p = 0; p < num_parts; ++p) {
+        total += loads[p];
     }
 
-    if ((elts_glob.j % num_subdomains.j) && (proc_ind_j == num_subdomains.j - 1)) {
-        int remainder = elts_glob.j - elts_loc.j * (proc_ind_j + 1);
-        elts_loc.j += remainder;
+    for(int p = 0; p < num_parts; ++p) {
+        double share = num_cells * loads[p] / total;
+        sizes[p] = floor(share);
+        fractions[p] = share - sizes[p];
+        assigned += sizes[p];
     }
 
-    findNeighborsIds();
-    checkForPhysicalBoundaries();
+    /* The first of the equal fractions wins, i.e. the leading parts on ties. */
+    for(; assigned < num_cells; ++assigned) {
+        int p = max_element(fractions.begin(), fractions.end()) - fractions.begin();
+        ++sizes[p];
+        fractions[p] = -1.0;
+    }
+
+    /* Parts with tiny loads still get a cell from the largest ones. */
+    for(int p = 0; p < num_parts && num_cells >= num_parts; ++p) {
+        if (sizes[p] == 0) {
+            int q = max_element(sizes.begin(), sizes.end()) - sizes.begin();
+            --sizes[q];
+            ++sizes[p];
+        }
+    }
+
+    size = sizes[part];
+    beg = 0;
+    for(int p = 0; p < part; ++p) {
+        beg += sizes[p];
+    }
+}
+
+IndicesIJ Decomposition::findNodeGrid(int num_nodes, const IndicesIJ &num_procs,
+                                      const IndicesIJ &elts_glob) {
+
+    IndicesIJ best(0, 0);
+    long best_cut = -1;
+
+    for(int ni = 1; ni <= num_nodes; ++ni) {
+        int nj = num_nodes / ni;
+        if (num_nodes % ni || num_procs.i % ni || num_procs.j % nj)
+            continue;
+
+        long cut = (long)(ni - 1) * elts_glob.j + (long)(nj - 1) * elts_glob.i;
+        if (best_cut < 0 || cut < best_cut) {
+            best = IndicesIJ(ni, nj);
+            best_cut = cut;
+        }
+    }
+
+    return best;
+}
+
+int Decomposition::decomposeBlocks(int blocks_per_proc, const IndicesIJ elts_glob,
+                                   const IndicesIJ elts_loc) {
+
+    int too_small = 0;          // Number of subdomains with fewer cells than blocks
+
+    num_blocks = findProcessGrid(blocks_per_proc,
+                                 IndicesIJ(elts_glob.i / num_subdomains.i,
+                                           elts_glob.j / num_subdomains.j));
+
+    if (elts_loc.i < num_blocks.i || elts_loc.j < num_blocks.j)
+        too_small = 1;
+    findGlobalSum(too_small);
+    if (too_small > 0) {
+        printByRoot("Error! A subdomain has fewer cells than blocks.");
+        num_blocks = IndicesIJ(1, 1);
+        return EXIT_FAILURE;
+    }
 
     return EXIT_SUCCESS;
 }
 
+void Decomposition::getBlock(const IndicesIJ block_ind, const IndicesIJ elts_loc,
+                             IndicesIJ &elts_block, IndicesIJ &beg_block) const {
+
+    splitCells(elts_loc.i, vector<double>(num_blocks.i, 1.0), block_ind.i,
+               elts_block.i, beg_block.i);
+    splitCells(elts_loc.j, vector<double>(num_blocks.j, 1.0), block_ind.j,
+               elts_block.j, beg_block.j);
+}
+
+IndicesIJ Decomposition::findProcessGrid(int num_procs, const IndicesIJ &elts_glob) {
+
+    IndicesIJ best(num_procs, 1);
+    long best_cut = -1;
+    bool best_fits = false;
+
+    for(int pi = 1; pi <= num_procs; ++pi) {
+        if (num_procs % pi)
+            continue;
+
+        int pj = num_procs / pi;
+        long cut = (long)(pi - 1) * elts_glob.j + (long)(pj - 1) * elts_glob.i;
+        bool fits = (pi <= elts_glob.i) && (pj <= elts_glob.j);
+
+        /* A grid without empty subdomains always wins. */
+        if (best_cut < 0 || (fits && !best_fits) || (fits == best_fits && cut < best_cut)) {
+            best = IndicesIJ(pi, pj);
+            best_cut = cut;
+            best_fits = fits;
+        }
+    }
+
+    return best;
+}
+
 int Decomposition::findNeighborsIds() {
 
     int my_rank = getMyRank();
@@ -142,6 +369,20 @@ int Decomposition::findNeighborsIds() {
     if (getProcCoord(proc_ind_i, proc_ind_j) == EXIT_FAILURE)
         return EXIT_FAILURE;
 
+#ifdef USE_MPI
+    /* Neighbors are ranks in the Cartesian communicator, MPI_PROC_NULL stands for none. */
+    int west = MPI_PROC_NULL, east = MPI_PROC_NULL, south = MPI_PROC_NULL, north = MPI_PROC_NULL;
+
+    MPI_Comm_rank(getCommunicator(), &my_rank);
+    MPI_Cart_shift(getCommunicator(), 0, 1, &west, &east);
+    MPI_Cart_shift(getCommunicator(), 1, 1, &south, &north);
+
+    ngb_pid.central = my_rank;
+    ngb_pid.west = (west == MPI_PROC_NULL) ? EMPTY : west;
+    ngb_pid.east = (east == MPI_PROC_NULL) ? EMPTY : east;
+    ngb_pid.south = (south == MPI_PROC_NULL) ? EMPTY : south;
+    ngb_pid.north = (north == MPI_PROC_NULL) ? EMPTY : north;
+#else
     ngb_pid.central = my_rank;
 
     /* Check the west neighbor. */
@@ -159,6 +400,7 @@ int Decomposition::findNeighborsIds() {
     /* Check the north neighbor. */
     if (proc_ind_j!= num_subdomains.j - 1)
         ngb_pid.north = getProcInd(proc_ind_i, proc_ind_j + 1);
+#endif
 
     return EXIT_SUCCESS;
 }
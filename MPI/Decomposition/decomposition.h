@@ -32,6 +32,7 @@
 #include "../../General/macro.h"
 #include "../../General/structs.h"
 #include <vector>
+#include <memory>
 
 /*!
  * @class Decomposition
@@ -39,20 +40,35 @@
  */
 class Decomposition {
     IndicesIJ num_subdomains;   // Total number of subdomains in each direction
+    IndicesIJ num_blocks;       // Number of blocks of every subdomain in each direction
+    IndicesIJ proc_ind;         // Coordinates of the local subdomain in the
+                                // grid of subdomains
     Neighbors ngb_pid;          // Structure with indicators of the PIDs of the
                                 // neighboring subdomains (EMPTY stands for "no neighbor")
     Neighbors phys_bound;       // Structure with indicators of the presence of
                                 // the physical (real) boundary (PHYS_BOUNDARY
                                 // stands for existing physical boundary)
+    int halo_comm;              // Way the halos are exchanged (see HALO_* in macro.h)
+    double weight;              // Relative throughput of the local process
+#ifdef USE_MPI
+    std::shared_ptr<MPI_Comm> cart_comm;    // Cartesian communicator, shared by the copies
+    std::shared_ptr<MPI_Comm> node_comm;    // Sub-domains of the same node (HALO_SHARED only)
+#endif
 
 public:
     /*!
      * @brief Default constructor.
      */
-    Decomposition() : num_subdomains(1, 1) { }
+    Decomposition() : num_subdomains(1, 1), num_blocks(1, 1), halo_comm(HALO_P2P), weight(1.0) { }
 
     /*!
      * @brief Decompose the domain.
+     * The cut lines are placed so that the number of cells of every process
+     * follows its weight: the i-th extent of a column of subdomains is
+     * proportional to the sum of the weights of the column, and the same for
+     * the rows. With equal weights, the leading processes get one extra cell
+     * if the number of cells is not divisible.
+     * @note This is a collective call.
      * @param num_procs [in] Number of subdomains in each direction.
      * @param elts_glob [in] Global number of elements/cells in each direction.
      * @param elts_loc [out] Local number of elements/cells in each direction.
@@ -62,6 +78,57 @@ public:
     int decompose(const IndicesIJ num_procs, const IndicesIJ elts_glob,
                   IndicesIJ &elts_loc, IndicesIJ &beg_ind_glob);
 
+    /*!
+     * @brief Find the grid of subdomains with the smallest total length of
+     *        the cuts, i.e. the smallest number of halo cells.
+     * Cutting the domain (i x j) into pi x pj subdomains makes
+     * \f[ (p_i - 1) n_j + (p_j - 1) n_i \f] cells on each side of the cuts.
+     * Subdomains have at least one cell in each direction if possible.
+     * @param num_procs [in] Total number of subdomains.
+     * @param elts_glob [in] Global number of elements/cells in each direction.
+     * @return Number of subdomains in each direction.
+     */
+    static IndicesIJ findProcessGrid(int num_procs, const IndicesIJ &elts_glob);
+
+    /*!
+     * @brief Find the grid of nodes, every node owns a tile of the grid of
+     *        subdomains.
+     * Among the grids that divide the grid of subdomains, the one with the
+     * smallest number of cells along the cuts between the nodes is chosen.
+     * @param num_nodes [in] Number of nodes, all with the same number of processes.
+     * @param num_procs [in] Number of subdomains in each direction.
+     * @param elts_glob [in] Global number of elements/cells in each direction.
+     * @return Number of nodes in each direction, (0, 0) if the grid of
+     *         subdomains can't be tiled.
+     */
+    static IndicesIJ findNodeGrid(int num_nodes, const IndicesIJ &num_procs,
+                                  const IndicesIJ &elts_glob);
+
+    /*!
+     * @brief Split every subdomain into a grid of blocks (over-decomposition).
+     * All subdomains use the same grid, chosen by \e findProcessGrid() for the
+     * average subdomain, so the blocks along a cut line match the blocks of
+     * the neighbor.
+     * @note This is a collective call.
+     * @param blocks_per_proc [in] Number of blocks of every subdomain.
+     * @param elts_glob [in] Global number of elements/cells in each direction.
+     * @param elts_loc [in] Local number of elements/cells in each direction.
+     * @return EXIT_FAILURE if a subdomain has fewer cells than blocks in some
+     *         direction, EXIT_SUCCESS otherwise.
+     */
+    int decomposeBlocks(int blocks_per_proc, const IndicesIJ elts_glob, const IndicesIJ elts_loc);
+
+    /*!
+     * @brief Find the cells of a block of the local subdomain.
+     * The cells are split evenly, the leading blocks get the remainder.
+     * @param block_ind [in] Coordinates of the block in the grid of blocks.
+     * @param elts_loc [in] Local number of elements/cells in each direction.
+     * @param elts_block [out] Number of cells of the block in each direction.
+     * @param beg_block [out] Local indices of the very first cell of the block.
+     */
+    void getBlock(const IndicesIJ block_ind, const IndicesIJ elts_loc,
+                  IndicesIJ &elts_block, IndicesIJ &beg_block) const;
+
     /*!
      * @brief Return a structure of the neighboring processes IDs.
      * If there is no neighboring process, the member of the structure is set
@@ -77,6 +144,65 @@ public:
      */
     inline const Neighbors &getPhysBound() const { return phys_bound; }
 
+    /*!
+     * @brief Return the total number of subdomains in each direction.
+     */
+    inline IndicesIJ getNumSubdomains() const { return num_subdomains; }
+
+    /*!
+     * @brief Return the number of blocks of every subdomain in each direction.
+     */
+    inline IndicesIJ getNumBlocks() const { return num_blocks; }
+
+    /*!
+     * @brief Return the coordinates of the local subdomain in the grid of
+     *        subdomains.
+     */
+    inline IndicesIJ getProcIndices() const { return proc_ind; }
+
+    /*!
+     * @brief Set the way the halos are exchanged.
+     * @param type [in] One of HALO_* (see macro.h)
+     */
+    inline void setHaloComm(int type) { halo_comm = type; }
+
+    /*!
+     * @brief Return the way the halos are exchanged (see HALO_* in macro.h).
+     */
+    inline int getHaloComm() const { return halo_comm; }
+
+    /*!
+     * @brief Set the relative throughput of the local process, should be set
+     *        before the domain is decomposed.
+     * @param in_weight [in] Positive weight, 1 by default
+     */
+    inline void setWeight(double in_weight) { weight = in_weight; }
+
+    /*!
+     * @brief Return the relative throughput of the local process.
+     */
+    inline double getWeight() const { return weight; }
+
+#ifdef USE_MPI
+    /*!
+     * @brief Return the Cartesian communicator of the sub-domains.
+     * The neighbor IDs are ranks in this communicator. Before the domain is
+     * decomposed, MPI_COMM_WORLD is returned.
+     */
+    inline MPI_Comm getCommunicator() const {
+        return cart_comm ? *cart_comm : MPI_COMM_WORLD;
+    }
+
+    /*!
+     * @brief Return the communicator of the sub-domains sharing the memory of
+     * the node. It is only created for HALO_SHARED, otherwise MPI_COMM_SELF
+     * is returned.
+     */
+    inline MPI_Comm getNodeCommunicator() const {
+        return node_comm ? *node_comm : MPI_COMM_SELF;
+    }
+#endif
+
 private:
     /*!
      * @brief Evaluate process IDs of the neighboring sub-domains.
@@ -89,6 +215,44 @@ private:
      */
     void checkForPhysicalBoundaries();
 
+    /*!
+     * @brief Split the cells of one direction proportionally to the loads of
+     *        the parts.
+     * Every part gets the integer part of its share, the remaining cells go
+     * to the parts with the largest fractions (the leading ones on ties).
+     * Every part gets at least one cell if possible.
+     * @param num_cells [in] Number of cells to split
+     * @param loads [in] Load of every part
+     * @param part [in] Index of the local part
+     * @param size [out] Number of cells of the local part
+     * @param beg [out] Index of the first cell of the local part
+     */
+    static void splitCells(int num_cells, const std::vector<double> &loads, int part,
+                           int &size, int &beg);
+
+#ifdef USE_MPI
+    /*!
+     * @brief Create the Cartesian communicator of the sub-domains.
+     * The ranks are reordered so that every node gets a compact tile of the
+     * grid of sub-domains, see \e findNodeAwareRank(). For HALO_SHARED, the
+     * communicator of the node is split off.
+     * @param elts_glob [in] Global number of elements/cells in each direction.
+     */
+    void createCommunicator(const IndicesIJ &elts_glob);
+
+    /*!
+     * @brief Find the position of the local process in the grid of
+     *        sub-domains, so that the processes of a node form a tile.
+     * The nodes are found by MPI_Comm_split_type(). If the nodes have
+     * different numbers of processes or the grid can't be tiled, the ranks
+     * keep their order.
+     * @note This is a collective call.
+     * @param elts_glob [in] Global number of elements/cells in each direction.
+     * @return Rank of the local process in the grid, j + i * nj.
+     */
+    int findNodeAwareRank(const IndicesIJ &elts_glob);
+#endif
+
     /*!
      * @brief Calculate the coordinates of the sub-domain based on its rank.
      * @param proc_ind_i [out] Coordinate in i-th direction.
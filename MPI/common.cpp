@@ -28,6 +28,8 @@
 #include <iostream>
 #include "common.h"
 #include "../General/macro.h"
+#include "threads.h"
+#include "reduction.h"
 
 void findGlobalMin(double &value) {
 
@@ -37,6 +39,8 @@ void findGlobalMin(double &value) {
      *  - use MPI_IN_PLACE to "replace" the value
      */
     NOT_IMPLEMENTED
+#elif defined(USE_THREADS)
+    threadAllreduce(&value, 1, REDUCE_MIN);
 #endif
 }
 
@@ -48,6 +52,8 @@ void findGlobalMax(double &value) {
      *  - use MPI_IN_PLACE to "replace" the value
      */
     NOT_IMPLEMENTED
+#elif defined(USE_THREADS)
+    threadAllreduce(&value, 1, REDUCE_MAX);
 #endif
 }
 
@@ -56,6 +62,8 @@ int getMyRank() {
     int my_rank = 0;
 #ifdef USE_MPI
     NOT_IMPLEMENTED
+#elif defined(USE_THREADS)
+    my_rank = getThreadRank();
 #endif
     return my_rank;
 }
@@ -65,6 +73,8 @@ int getNumProcs() {
     int num_procs = 1;
 #ifdef USE_MPI
     NOT_IMPLEMENTED
+#elif defined(USE_THREADS)
+    num_procs = getThreadNumRanks();
 #endif
     return num_procs;
 }
@@ -76,6 +86,8 @@ void findGlobalSum(double &value) {
      *  - use MPI_IN_PLACE to "replace" the value
      */
     NOT_IMPLEMENTED
+#elif defined(USE_THREADS)
+    threadAllreduce(&value, 1, REDUCE_SUM);
 #endif
 }
 
@@ -86,13 +98,26 @@ void findGlobalSum(int &value) {
      *  - use MPI_IN_PLACE to "replace" the value
      */
     NOT_IMPLEMENTED
+#elif defined(USE_THREADS)
+    double sum = value;
+    threadAllreduce(&sum, 1, REDUCE_SUM);
+    value = (int)sum;
 #endif
 }
 
 void initialize(int argc, char** argv) {
 #ifdef USE_MPI
+#if defined(_OPENMP) || defined(USE_POOL)
+    int provided = 0;
+    /*
+     * The threads communicate one at a time, the master thread (see
+     * Solver::solveAsync()) or a task (see BlockJacobi::sweepDataflow()).
+     */
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SERIALIZED, &provided);
+#else
     MPI_Init(&argc, &argv);
 #endif
+#endif
 }
 
 void finalize() {
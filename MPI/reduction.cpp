@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file reduction.cpp
+ * @brief Contains definitions of methods from the \e Reduction class.
+ */
+
+#include <algorithm>
+#include "reduction.h"
+#include "threads.h"
+
+#ifdef USE_MPI
+static MPI_Op getMpiOp(int op) {
+
+    switch (op) {
+        case REDUCE_MIN: return MPI_MIN;
+        case REDUCE_MAX: return MPI_MAX;
+        default: return MPI_SUM;
+    }
+}
+
+static void freeCommunicator(MPI_Comm &comm) {
+
+    if (comm != MPI_COMM_NULL)
+        MPI_Comm_free(&comm);
+    comm = MPI_COMM_NULL;
+}
+#endif
+
+Reduction::Reduction() : op(REDUCE_SUM), stage(STAGE_NONE), hierarchical(false) {
+
+#ifdef USE_MPI
+    comm = MPI_COMM_NULL;
+    node_comm = MPI_COMM_NULL;
+    leader_comm = MPI_COMM_NULL;
+    request = MPI_REQUEST_NULL;
+#endif
+}
+
+Reduction& Reduction::operator=(const Reduction &other) {
+
+    if (this != &other)
+        clear();
+
+    return *this;
+}
+
+Reduction::~Reduction() {
+
+    clear();
+}
+
+void Reduction::clear() {
+
+#ifdef USE_MPI
+    int finalized = 0;
+
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        wait();
+        freeCommunicator(comm);
+        freeCommunicator(node_comm);
+        freeCommunicator(leader_comm);
+    }
+    comm = node_comm = leader_comm = MPI_COMM_NULL;
+#endif
+    stage = STAGE_NONE;
+    hierarchical = false;
+}
+
+void Reduction::setup(bool in_hierarchical) {
+
+#ifdef USE_MPI
+    if (in_hierarchical == hierarchical && (comm != MPI_COMM_NULL || node_comm != MPI_COMM_NULL))
+        return;
+
+    clear();
+    hierarchical = in_hierarchical;
+
+    if (hierarchical) {
+        int rank = 0;
+        int node_rank = 0;
+
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node_comm);
+        MPI_Comm_rank(node_comm, &node_rank);
+        MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &leader_comm);
+    }
+    else {
+        MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+    }
+#else
+    hierarchical = in_hierarchical;
+#endif
+}
+
+void Reduction::start(const double *in_values, int count, int in_op) {
+
+    values.assign(in_values, in_values + count);
+    partial.assign(count, 0.0);
+    result.assign(count, 0.0);
+    op = in_op;
+
+#ifdef USE_MPI
+    if (comm == MPI_COMM_NULL && node_comm == MPI_COMM_NULL)
+        setup(false);
+
+    stage = hierarchical ? STAGE_NODE : STAGE_ALL;
+    if (hierarchical)
+        MPI_Ireduce(values.data(), partial.data(), count, MPI_DOUBLE, getMpiOp(op), 0, node_comm,
+                    &request);
+    else
+        MPI_Iallreduce(values.data(), result.data(), count, MPI_DOUBLE, getMpiOp(op), comm,
+                       &request);
+#else
+    result = values;
+#ifdef USE_THREADS
+    /* The ranks meet in the collective, so the reduction completes here. */
+    threadAllreduce(result.data(), count, op);
+#endif
+    stage = STAGE_NONE;
+#endif
+}
+
+void Reduction::advance() {
+
+#ifdef USE_MPI
+    int count = values.size();
+
+    switch (stage) {
+        case STAGE_NODE:
+            if (leader_comm != MPI_COMM_NULL) {
+                stage = STAGE_LEADERS;
+                MPI_Iallreduce(partial.data(), result.data(), count, MPI_DOUBLE, getMpiOp(op),
+                               leader_comm, &request);
+                break;
+            }
+            /* Processes other than the leader only wait for the broadcast */
+            // fall through
+        case STAGE_LEADERS:
+            stage = STAGE_BCAST;
+            MPI_Ibcast(result.data(), count, MPI_DOUBLE, 0, node_comm, &request);
+            break;
+
+        default:
+            stage = STAGE_NONE;
+            break;
+    }
+#else
+    stage = STAGE_NONE;
+#endif
+}
+
+bool Reduction::test() {
+
+#ifdef USE_MPI
+    while (stage != STAGE_NONE) {
+        int flag = 0;
+        MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+        if (!flag)
+            return false;
+        advance();
+    }
+#endif
+    return true;
+}
+
+void Reduction::wait() {
+
+#ifdef USE_MPI
+    while (stage != STAGE_NONE) {
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        advance();
+    }
+#endif
+}
+
+void Reduction::reduce(double *in_values, int count, int in_op) {
+
+    start(in_values, count, in_op);
+    wait();
+    std::copy(result.begin(), result.end(), in_values);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file reduction.h
+ * @brief Contains declaration of the \e Reduction class.
+ */
+
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include <vector>
+
+/* Operations of the reductions */
+enum {
+    REDUCE_SUM,
+    REDUCE_MIN,
+    REDUCE_MAX,
+};
+
+/*!
+ * @class Reduction
+ * @brief Global reduction of a few values which can run in the background.
+ *
+ * The flat reduction is a single nonblocking allreduce over all processes.
+ * The hierarchical one follows the machine: the values are first reduced
+ * within every node, where the messages go through the shared memory, then
+ * across the leaders (ranks 0) of the nodes, and the results are broadcast
+ * within the nodes. Only one value per node crosses the network. The stages
+ * are nonblocking too, every call of \e test() starts the next one.
+ *
+ * The reduction uses its own communicators, so it may be in flight while
+ * other collectives are called.
+ */
+class Reduction {
+
+    enum {
+        STAGE_NONE,                 // No reduction in flight
+        STAGE_ALL,                  // Flat reduction over all processes
+        STAGE_NODE,                 // Reduction within the node
+        STAGE_LEADERS,              // Reduction across the leaders of the nodes
+        STAGE_BCAST,                // Broadcast of the results within the node
+    };
+
+    std::vector<double> values;     // Local contributions
+    std::vector<double> partial;    // Results within the node (hierarchical only)
+    std::vector<double> result;     // Results over all processes
+    int op;                         // Operation (see REDUCE_*)
+    int stage;                      // Stage in flight, STAGE_NONE if none
+    bool hierarchical;              // True for the node-aware reduction
+#ifdef USE_MPI
+    MPI_Comm comm;                  // All processes (flat reduction)
+    MPI_Comm node_comm;             // Processes sharing the memory of the node
+    MPI_Comm leader_comm;           // Ranks 0 of the nodes, MPI_COMM_NULL on the others
+    MPI_Request request;            // Request of the stage in flight
+#endif
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    Reduction();
+
+    /*!
+     * @brief Copy constructor, creates an empty object to be set up again.
+     */
+    Reduction(const Reduction&) : Reduction() { }
+
+    /*!
+     * @brief Assignment operator, leaves the object empty.
+     */
+    Reduction& operator=(const Reduction &other);
+
+    /*!
+     * @brief Destructor, frees the communicators.
+     */
+    ~Reduction();
+
+    /*!
+     * @brief Create the communicators, nothing is done if they exist.
+     * @note This is a collective call.
+     * @param in_hierarchical [in] True for the node-aware reduction
+     */
+    void setup(bool in_hierarchical);
+
+    /*!
+     * @brief Start the reduction.
+     * @note This is a collective call. The previous reduction should be complete.
+     * @param in_values [in] Local contributions
+     * @param count [in] Number of values
+     * @param in_op [in] Operation (see REDUCE_*)
+     */
+    void start(const double *in_values, int count, int in_op);
+
+    /*!
+     * @brief Progress the reduction.
+     * @return True if the reduction is complete, false otherwise.
+     */
+    bool test();
+
+    /*!
+     * @brief Wait for the reduction to complete, returns at once if none is
+     *        in flight.
+     */
+    void wait();
+
+    /*!
+     * @brief Reduce the values in place, i.e. start the reduction and wait
+     *        for it.
+     * @note This is a collective call.
+     * @param in_values [in/out] Local contributions, replaced by the results
+     * @param count [in] Number of values
+     * @param in_op [in] Operation (see REDUCE_*)
+     */
+    void reduce(double *in_values, int count, int in_op);
+
+    /*!
+     * @brief Check whether a reduction is in flight.
+     */
+    inline bool isActive() const { return stage != STAGE_NONE; }
+
+    /*!
+     * @brief Return a result of the last completed reduction.
+     * @param k [in] Index of the value
+     */
+    inline double getResult(int k) const { return result[k]; }
+
+private:
+    /*!
+     * @brief Start the next stage of the reduction in flight.
+     */
+    void advance();
+
+    /*!
+     * @brief Free the communicators.
+     */
+    void clear();
+};
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file threads.cpp
+ * @brief Contains C-based definitions of the in-process runtime that stands
+ *        in for MPI.
+ */
+
+#ifdef USE_THREADS
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "threads.h"
+#include "reduction.h"
+
+/* Message waiting in the mailbox of the receiver */
+struct Message {
+    int source;
+    int tag;
+    std::vector<double> data;
+};
+
+/* Messages sent to a rank */
+struct Mailbox {
+    std::mutex mutex;
+    std::condition_variable arrived;
+    std::deque<Message> messages;
+};
+
+static thread_local int thread_rank = 0;            // Rank of the calling thread
+static int num_thread_ranks = 1;                    // Number of ranks
+static std::unique_ptr<Mailbox[]> mailboxes;        // Mailbox of every rank
+
+/* State of the collective in progress */
+static std::mutex coll_mutex;
+static std::condition_variable coll_done;
+static int coll_arrived = 0;                        // Ranks that have arrived
+static long coll_generation = 0;                    // Number of completed collectives
+static std::vector<std::vector<double>> coll_values;// Contribution of every rank
+static std::vector<double> coll_result;             // Result of the last collective
+
+int findNumThreadRanks(int argc, char** argv) {
+
+    for(int n = 1; n < argc - 2; ++n) {
+        if (strcmp(argv[n], "-d") == 0) {
+            int num_ranks = atoi(argv[n + 1]) * atoi(argv[n + 2]);
+            if (num_ranks > 0)
+                return num_ranks;
+        }
+    }
+
+    const char *env = getenv("NUM_RANKS");
+    if (env != nullptr && atoi(env) > 0)
+        return atoi(env);
+
+    return 1;
+}
+
+int runThreadRanks(int num_ranks, int (*body)(int, char**), int argc, char** argv) {
+
+    std::vector<std::thread> threads;
+    std::vector<int> exit_status(num_ranks, EXIT_SUCCESS);
+
+    num_thread_ranks = num_ranks;
+    mailboxes.reset(new Mailbox[num_ranks]);
+    coll_values.assign(num_ranks, std::vector<double>());
+
+    for(int rank = 0; rank < num_ranks; ++rank) {
+        threads.emplace_back([=, &exit_status]() {
+            thread_rank = rank;
+            exit_status[rank] = body(argc, argv);
+        });
+    }
+
+    for(auto &thread : threads)
+        thread.join();
+
+    for(int status : exit_status) {
+        if (status != EXIT_SUCCESS)
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int getThreadRank() {
+    return thread_rank;
+}
+
+int getThreadNumRanks() {
+    return num_thread_ranks;
+}
+
+void threadAllreduce(double *values, int count, int op) {
+
+    std::unique_lock<std::mutex> lock(coll_mutex);
+    long generation = coll_generation;
+
+    coll_values[thread_rank].assign(values, values + count);
+
+    /* The last rank to arrive combines the contributions and wakes up the others. */
+    if (++coll_arrived == num_thread_ranks) {
+        coll_result = coll_values[0];
+        for(int rank = 1; rank < num_thread_ranks; ++rank) {
+            for(int n = 0; n < count; ++n) {
+                double value = coll_values[rank][n];
+                switch (op) {
+                    case REDUCE_MIN: coll_result[n] = std::min(coll_result[n], value); break;
+                    case REDUCE_MAX: coll_result[n] = std::max(coll_result[n], value); break;
+                    default: coll_result[n] += value; break;
+                }
+            }
+        }
+        coll_arrived = 0;
+        ++coll_generation;
+        coll_done.notify_all();
+    }
+    else {
+        coll_done.wait(lock, [&]() { return coll_generation != generation; });
+    }
+
+    /* The result is kept until all ranks have arrived at the next collective. */
+    std::copy(coll_result.begin(), coll_result.begin() + count, values);
+}
+
+void threadBarrier() {
+    threadAllreduce(nullptr, 0, REDUCE_SUM);
+}
+
+void threadSend(int dest, int tag, const double *data, int count) {
+
+    Mailbox &mailbox = mailboxes[dest];
+
+    {
+        std::lock_guard<std::mutex> lock(mailbox.mutex);
+        mailbox.messages.push_back({thread_rank, tag, std::vector<double>(data, data + count)});
+    }
+    mailbox.arrived.notify_all();
+}
+
+void threadRecv(int source, int tag, double *data, int count) {
+
+    Mailbox &mailbox = mailboxes[thread_rank];
+    std::unique_lock<std::mutex> lock(mailbox.mutex);
+    std::deque<Message>::iterator message;
+
+    mailbox.arrived.wait(lock, [&]() {
+        message = std::find_if(mailbox.messages.begin(), mailbox.messages.end(),
+                               [&](const Message &msg) {
+                                   return msg.source == source && msg.tag == tag;
+                               });
+        return message != mailbox.messages.end();
+    });
+
+    std::copy(message->data.begin(),
+              message->data.begin() + std::min(count, (int)message->data.size()), data);
+    mailbox.messages.erase(message);
+}
+
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file threads.h
+ * @brief Contains C-based declarations of the in-process runtime that stands
+ *        in for MPI.
+ *
+ * With USE_THREADS every "process" is a thread of a single program. The ranks
+ * exchange messages through the mailboxes in the shared memory and meet in
+ * the collectives, so a decomposed problem runs on one node without MPI. Only
+ * the calls of common.h, the halo exchanges of \e Vector, \e DeepHalo and
+ * \e BlockJacobi, \e Reduction and the output are backed by the runtime, the
+ * other MPI-based features are not available in this mode.
+ */
+
+#ifndef THREADS_H
+#define THREADS_H
+
+#ifdef USE_THREADS
+
+#ifdef USE_MPI
+#error "USE_THREADS and USE_MPI can't be combined."
+#endif
+
+/*!
+ * @brief Find the number of ranks to run: Pi * Pj of the `-d Pi Pj` option,
+ *        otherwise the value of the NUM_RANKS environment variable, or 1.
+ * @param argc [in] Number of command line arguments.
+ * @param argv [in] List of command line arguments.
+ */
+int findNumThreadRanks(int argc, char** argv);
+
+/*!
+ * @brief Run the function by every rank, each on its own thread, and wait
+ *        for all of them.
+ * @param num_ranks [in] Number of ranks.
+ * @param body [in] Function executed by the ranks.
+ * @param argc [in] Number of command line arguments.
+ * @param argv [in] List of command line arguments.
+ * @return EXIT_FAILURE if any rank has failed, EXIT_SUCCESS otherwise.
+ */
+int runThreadRanks(int num_ranks, int (*body)(int, char**), int argc, char** argv);
+
+/*!
+ * @brief Get the rank of the calling thread.
+ */
+int getThreadRank();
+
+/*!
+ * @brief Get the number of ranks.
+ */
+int getThreadNumRanks();
+
+/*!
+ * @brief Reduce the values over all ranks. The contributions are combined in
+ *        the order of the ranks, so the result doesn't depend on the timing.
+ * @note This function replaces input with the output.
+ * @param values [in/out] The values to reduce.
+ * @param count [in] Number of values.
+ * @param op [in] Operation (see REDUCE_* in reduction.h).
+ */
+void threadAllreduce(double *values, int count, int op);
+
+/*!
+ * @brief Wait until all ranks have reached the barrier.
+ */
+void threadBarrier();
+
+/*!
+ * @brief Put a copy of the message into the mailbox of the receiver. The call
+ *        never blocks.
+ * @param dest [in] Rank of the receiver.
+ * @param tag [in] Tag of the message.
+ * @param data [in] The message.
+ * @param count [in] Number of values in the message.
+ */
+void threadSend(int dest, int tag, const double *data, int count);
+
+/*!
+ * @brief Take the message from the mailbox of the calling rank, waiting for
+ *        it if needed. Messages with the same source and tag are received in
+ *        the order they were sent.
+ * @param source [in] Rank of the sender.
+ * @param tag [in] Tag of the message.
+ * @param data [out] The message.
+ * @param count [in] Number of values in the message.
+ */
+void threadRecv(int source, int tag, double *data, int count);
+
+#endif
+#endif
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file banded_cholesky.cpp
+ * @brief Contains definitions of methods from the \e BandedCholesky class.
+ */
+
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "banded_cholesky.h"
+
+void BandedCholesky::clear() {
+
+    size = 0;
+    bandwidth = 0;
+    factor.clear();
+}
+
+int BandedCholesky::factorize(int in_size, int in_bandwidth, const vector<double> &band) {
+
+    int width = in_bandwidth + 1;
+
+    clear();
+    factor = band;
+
+    /*
+     * Row-oriented factorization: L(n, m) = (A(n, m) - sum_k L(n, k) L(m, k)) / L(m, m),
+     * where both rows share the columns k within the band.
+     */
+    for(int n = 0; n < in_size; ++n) {
+        int first = std::max(0, n - in_bandwidth);
+        double *row_n = &factor[n * width + in_bandwidth - n];
+
+        for(int m = first; m <= n; ++m) {
+            const double *row_m = &factor[m * width + in_bandwidth - m];
+            int k_beg = std::max(first, m - in_bandwidth);
+            double sum = row_n[m];
+
+#pragma omp simd reduction(-:sum)
+            for(int k = k_beg; k < m; ++k) {
+                sum -= row_n[k] * row_m[k];
+            }
+
+            if (m < n) {
+                row_n[m] = sum / row_m[m];
+            }
+            else {
+                if (sum <= 0.0) {
+                    factor.clear();
+                    return EXIT_FAILURE;
+                }
+                row_n[n] = sqrt(sum);
+            }
+        }
+    }
+
+    size = in_size;
+    bandwidth = in_bandwidth;
+
+    return EXIT_SUCCESS;
+}
+
+void BandedCholesky::solve(double *rhs) const {
+
+    int width = bandwidth + 1;
+
+    /* Forward substitution L y = b */
+    for(int n = 0; n < size; ++n) {
+        const double *row_n = &factor[n * width + bandwidth - n];
+        double sum = rhs[n];
+
+#pragma omp simd reduction(-:sum)
+        for(int k = std::max(0, n - bandwidth); k < n; ++k) {
+            sum -= row_n[k] * rhs[k];
+        }
+        rhs[n] = sum / row_n[n];
+    }
+
+    /* Backward substitution L^T x = y, column-wise over the rows of L */
+    for(int n = size - 1; n >= 0; --n) {
+        const double *row_n = &factor[n * width + bandwidth - n];
+        double value = rhs[n] / row_n[n];
+
+        rhs[n] = value;
+#pragma omp simd
+        for(int k = std::max(0, n - bandwidth); k < n; ++k) {
+            rhs[k] -= row_n[k] * value;
+        }
+    }
+}
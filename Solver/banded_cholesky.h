@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file banded_cholesky.h
+ * @brief Contains declaration of the \e BandedCholesky class.
+ */
+
+#ifndef BANDED_CHOLESKY_H_
+#define BANDED_CHOLESKY_H_
+
+#include <vector>
+
+using namespace std;
+
+/*!
+ * @class BandedCholesky
+ * @brief Cholesky factorization \f[ A = L L^T \f] of a symmetric positive
+ *        definite banded matrix.
+ *
+ * The lower band of the matrix is stored row by row: element A(n, m) with
+ * n - bandwidth <= m <= n is kept at band[(m - n + bandwidth) + n * (bandwidth + 1)].
+ * For the 5-point stencil in the natural ordering j + i * nj the bandwidth
+ * is nj. The factors are kept, so repeated solves are two triangular solves.
+ */
+class BandedCholesky {
+    int size;               // Number of unknowns
+    int bandwidth;          // Number of sub-diagonals
+    vector<double> factor;  // Lower band of L, same storage as the matrix
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    BandedCholesky() : size(0), bandwidth(0) { }
+
+    /*!
+     * @brief Check whether the factors are available.
+     */
+    inline bool isFactorized() const { return size > 0; }
+
+    /*!
+     * @brief Release the factors.
+     */
+    void clear();
+
+    /*!
+     * @brief Factorize the matrix.
+     * @param in_size [in] Number of unknowns
+     * @param in_bandwidth [in] Number of sub-diagonals
+     * @param band [in] Lower band of the matrix
+     * @return EXIT_FAILURE if the matrix is not positive definite, EXIT_SUCCESS otherwise.
+     */
+    int factorize(int in_size, int in_bandwidth, const vector<double> &band);
+
+    /*!
+     * @brief Solve the factorized system.
+     * @param rhs [in/out] Right hand side, replaced with the solution
+     */
+    void solve(double *rhs) const;
+};
+
+#endif /* BANDED_CHOLESKY_H_ */
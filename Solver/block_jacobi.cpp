@@ -0,0 +1,393 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file block_jacobi.cpp
+ * @brief Contains definitions of methods from the \e BlockJacobi class.
+ */
+
+#include <cstring>
+#include "block_jacobi.h"
+#include "../MPI/common.h"
+#include "../MPI/threads.h"
+#include "../General/thread_pool.h"
+
+#define TAG_BLOCK 500
+
+BlockJacobi::BlockJacobi() : grid(0, 0) {
+
+#ifdef USE_MPI
+    comm = MPI_COMM_NULL;
+#endif
+}
+
+void BlockJacobi::setup(const Stencil &stencil, const Dimensions &dims, Vector &b) {
+
+    const Decomposition &decomp = dims.getDecomposition();
+    Neighbors ngb_pid = decomp.getNgbPid();
+    IndicesIJ elts_loc = stencil.getNumElts();
+
+    grid = decomp.getNumBlocks();
+    blocks.assign(grid.i * grid.j, Block());
+    faces.clear();
+
+    for(int bi = 0; bi < grid.i; ++bi) {
+        for(int bj = 0; bj < grid.j; ++bj) {
+            int index = bj + bi * grid.j;
+            Block &block = blocks[index];
+            IndicesIJ beg;
+            int size = 0;
+
+            decomp.getBlock(IndicesIJ(bi, bj), elts_loc, block.elts, beg);
+            size = block.elts.i * block.elts.j;
+
+            block.ngb.west = (bi > 0) ? index - grid.j : EMPTY;
+            block.ngb.east = (bi < grid.i - 1) ? index + grid.j : EMPTY;
+            block.ngb.south = (bj > 0) ? index - 1 : EMPTY;
+            block.ngb.north = (bj < grid.j - 1) ? index + 1 : EMPTY;
+
+            /* Blocks along a cut line face the blocks of the neighbor with the same index. */
+            if (bi == 0 && ngb_pid.west != EMPTY)
+                faces.push_back({index, FACE_WEST, ngb_pid.west, TAG_BLOCK + bj, {}, {}});
+            if (bi == grid.i - 1 && ngb_pid.east != EMPTY)
+                faces.push_back({index, FACE_EAST, ngb_pid.east, TAG_BLOCK + bj, {}, {}});
+            if (bj == 0 && ngb_pid.south != EMPTY)
+                faces.push_back({index, FACE_SOUTH, ngb_pid.south, TAG_BLOCK + bi, {}, {}});
+            if (bj == grid.j - 1 && ngb_pid.north != EMPTY)
+                faces.push_back({index, FACE_NORTH, ngb_pid.north, TAG_BLOCK + bi, {}, {}});
+
+            /* Couplings to the physical boundary are dropped. */
+            block.vec_id.assign(size, EMPTY);
+            block.coef_c.assign(size, 0.0);
+            block.coef_w.assign(size, 0.0);
+            block.coef_e.assign(size, 0.0);
+            block.coef_s.assign(size, 0.0);
+            block.coef_n.assign(size, 0.0);
+            block.rhs.assign(size, 0.0);
+            for(int i = 0; i < block.elts.i; ++i) {
+                for(int j = 0; j < block.elts.j; ++j) {
+                    int c = j + i * block.elts.j;
+                    int n = stencil.getID(beg.i + i, beg.j + j);
+
+                    block.vec_id[c] = n;
+                    block.coef_c[c] = stencil.getCentral(n);
+                    block.rhs[c] = b(n);
+                    if (stencil.getIdWest(n) != EMPTY)
+                        block.coef_w[c] = stencil.getWest(n);
+                    if (stencil.getIdEast(n) != EMPTY)
+                        block.coef_e[c] = stencil.getEast(n);
+                    if (stencil.getIdSouth(n) != EMPTY)
+                        block.coef_s[c] = stencil.getSouth(n);
+                    if (stencil.getIdNorth(n) != EMPTY)
+                        block.coef_n[c] = stencil.getNorth(n);
+                }
+            }
+
+            block.x.assign((block.elts.i + 2) * (block.elts.j + 2), 0.0);
+            block.x_next.assign((block.elts.i + 2) * (block.elts.j + 2), 0.0);
+        }
+    }
+
+    for(Face &face : faces) {
+        Block &block = blocks[face.block];
+        int length = (face.side == FACE_WEST || face.side == FACE_EAST) ? block.elts.j
+                                                                        : block.elts.i;
+        face.snd_buf.assign(length, 0.0);
+        face.rcv_buf.assign(length, 0.0);
+        ++block.num_remote;
+    }
+
+#ifdef USE_MPI
+    comm = decomp.getCommunicator();
+    snd_requests.assign(faces.size(), MPI_REQUEST_NULL);
+    rcv_requests.assign(faces.size(), MPI_REQUEST_NULL);
+#endif
+}
+
+void BlockJacobi::load(Vector &x) {
+
+#pragma omp parallel for
+    for(int b = 0; b < (int)blocks.size(); ++b) {
+        Block &block = blocks[b];
+        for(int i = 0; i < block.elts.i; ++i) {
+            for(int j = 0; j < block.elts.j; ++j) {
+                block.x[block.getExtID(i, j)] = x(block.vec_id[j + i * block.elts.j]);
+            }
+        }
+    }
+}
+
+void BlockJacobi::store(Vector &x) {
+
+#pragma omp parallel for
+    for(int b = 0; b < (int)blocks.size(); ++b) {
+        Block &block = blocks[b];
+        for(int i = 0; i < block.elts.i; ++i) {
+            for(int j = 0; j < block.elts.j; ++j) {
+                x(block.vec_id[j + i * block.elts.j]) = block.x[block.getExtID(i, j)];
+            }
+        }
+    }
+}
+
+void BlockJacobi::sweep(double omega, Vector &res) {
+
+#ifdef USE_MPI
+    int num_faces = faces.size();
+
+    for(int f = 0; f < num_faces; ++f) {
+        MPI_Irecv(faces[f].rcv_buf.data(), faces[f].rcv_buf.size(), MPI_DOUBLE, faces[f].pid,
+                  faces[f].tag, comm, &rcv_requests[f]);
+    }
+    for(int f = 0; f < num_faces; ++f) {
+        pack(faces[f], 0);
+        MPI_Isend(faces[f].snd_buf.data(), faces[f].snd_buf.size(), MPI_DOUBLE, faces[f].pid,
+                  faces[f].tag, comm, &snd_requests[f]);
+    }
+#elif defined(USE_THREADS)
+    /* The mailboxes keep copies of the messages, so the sends return immediately. */
+    for(Face &face : faces) {
+        pack(face, 0);
+        threadSend(face.pid, face.tag, face.snd_buf.data(), face.snd_buf.size());
+    }
+#endif
+
+    /*
+     * The master thread spawns the blocks without remote faces first, then
+     * every block whose last face has arrived. MPI is only called by the
+     * master thread.
+     */
+#pragma omp parallel
+#pragma omp master
+    {
+        vector<int> pending(blocks.size(), 0);
+
+        for(int b = 0; b < (int)blocks.size(); ++b) {
+            pending[b] = blocks[b].num_remote;
+            if (pending[b] == 0)
+                spawnBlock(b, omega, res);
+        }
+
+#ifdef USE_MPI
+        for(int k = 0; k < num_faces; ++k) {
+            int f = 0;
+            MPI_Waitany(num_faces, rcv_requests.data(), &f, MPI_STATUS_IGNORE);
+            unpack(faces[f], 0);
+            int b = faces[f].block;
+            if (--pending[b] == 0)
+                spawnBlock(b, omega, res);
+        }
+        MPI_Waitall(num_faces, snd_requests.data(), MPI_STATUSES_IGNORE);
+#elif defined(USE_THREADS)
+        for(Face &face : faces) {
+            threadRecv(face.pid, face.tag, face.rcv_buf.data(), face.rcv_buf.size());
+            unpack(face, 0);
+            if (--pending[face.block] == 0)
+                spawnBlock(face.block, omega, res);
+        }
+#endif
+    }
+
+#ifdef USE_POOL
+    ThreadPool::getInstance().wait();
+#endif
+
+    for(Block &block : blocks) {
+        block.x.swap(block.x_next);
+    }
+}
+
+void BlockJacobi::spawnBlock(int b, double omega, Vector &res) {
+
+#ifdef USE_POOL
+    /* Neighboring blocks are kept on the same or neighboring threads. */
+    ThreadPool::getInstance().submit(b, blocks.size(), [=, &res]() {
+        updateBlock(b, 0, omega, res);
+    });
+#else
+    /* The task is orphaned, the reference would be firstprivate otherwise. */
+#pragma omp task firstprivate(b) shared(res)
+    updateBlock(b, 0, omega, res);
+#endif
+}
+
+void BlockJacobi::sweepDataflow(int num_sweeps, double omega, Vector &res) {
+
+#if defined(USE_POOL) || !defined(_OPENMP)
+    /* The pool has no dependencies between the tasks, the sweeps are separated. */
+    for(int k = 0; k < num_sweeps; ++k)
+        sweep(omega, res);
+#else
+    int num_blocks = blocks.size();
+#ifdef USE_MPI
+    int num_faces = faces.size();
+#endif
+
+    /*
+     * The tasks depend on the tokens rather than on the data: the real cells
+     * of every block in both buffers, the halo of every block and MPI, in
+     * this order.
+     */
+    vector<char> tokens(3 * num_blocks + 1, 0);
+    char *token = tokens.data();
+    (void)token; // Only referenced by the depend clauses
+
+#pragma omp parallel
+#pragma omp single
+    {
+        for(int k = 0; k < num_sweeps; ++k) {
+            int src = k % 2;
+            int dst = 1 - src;
+
+#ifdef USE_MPI
+            /*
+             * A face leaves as soon as its block is updated, the previous
+             * message has to be gone before the buffer is refilled. The
+             * sends of a sweep precede its receives, so the chain of the
+             * tasks calling MPI can't deadlock.
+             */
+            for(int f = 0; f < num_faces; ++f) {
+                int b = faces[f].block;
+#pragma omp task firstprivate(f, src) depend(in: token[src * num_blocks + b]) depend(inout: token[3 * num_blocks])
+                {
+                    MPI_Wait(&snd_requests[f], MPI_STATUS_IGNORE);
+                    pack(faces[f], src);
+                    MPI_Isend(faces[f].snd_buf.data(), faces[f].snd_buf.size(), MPI_DOUBLE,
+                              faces[f].pid, faces[f].tag, comm, &snd_requests[f]);
+                }
+            }
+            for(int f = 0; f < num_faces; ++f) {
+                int b = faces[f].block;
+#pragma omp task firstprivate(f, src) depend(inout: token[2 * num_blocks + b], token[3 * num_blocks])
+                {
+                    MPI_Recv(faces[f].rcv_buf.data(), faces[f].rcv_buf.size(), MPI_DOUBLE,
+                             faces[f].pid, faces[f].tag, comm, MPI_STATUS_IGNORE);
+                    unpack(faces[f], src);
+                }
+            }
+#endif
+
+            for(int b = 0; b < num_blocks; ++b) {
+                const Neighbors &ngb = blocks[b].ngb;
+                int w = (ngb.west != EMPTY) ? ngb.west : b;
+                int e = (ngb.east != EMPTY) ? ngb.east : b;
+                int s = (ngb.south != EMPTY) ? ngb.south : b;
+                int n = (ngb.north != EMPTY) ? ngb.north : b;
+#pragma omp task firstprivate(b, src) \
+                 depend(in: token[src * num_blocks + b], token[src * num_blocks + w], \
+                            token[src * num_blocks + e], token[src * num_blocks + s], \
+                            token[src * num_blocks + n], token[2 * num_blocks + b]) \
+                 depend(out: token[dst * num_blocks + b])
+                updateBlock(b, src, omega, res);
+            }
+        }
+    }
+
+#ifdef USE_MPI
+    MPI_Waitall(num_faces, snd_requests.data(), MPI_STATUSES_IGNORE);
+#endif
+
+    /* The last iterate is expected in x. */
+    if (num_sweeps % 2 == 1) {
+        for(Block &block : blocks) {
+            block.x.swap(block.x_next);
+        }
+    }
+#endif
+}
+
+void BlockJacobi::updateBlock(int b, int src, double omega, Vector &res) {
+
+    Block &block = blocks[b];
+    vector<double> &x = block.getIterate(src);
+    vector<double> &x_next = block.getIterate(1 - src);
+    int ni = block.elts.i;
+    int nj = block.elts.j;
+    int stride = nj + 2;
+
+    /* Neighbors are read only, their new iterates go to the other buffer. */
+    if (block.ngb.west != EMPTY) {
+        const Block &ngb = blocks[block.ngb.west];
+        memcpy(&x[block.getExtID(-1, 0)], &ngb.getIterate(src)[ngb.getExtID(ngb.elts.i - 1, 0)],
+               nj * sizeof(double));
+    }
+    if (block.ngb.east != EMPTY) {
+        const Block &ngb = blocks[block.ngb.east];
+        memcpy(&x[block.getExtID(ni, 0)], &ngb.getIterate(src)[ngb.getExtID(0, 0)],
+               nj * sizeof(double));
+    }
+    if (block.ngb.south != EMPTY) {
+        const Block &ngb = blocks[block.ngb.south];
+        for(int i = 0; i < ni; ++i)
+            x[block.getExtID(i, -1)] = ngb.getIterate(src)[ngb.getExtID(i, ngb.elts.j - 1)];
+    }
+    if (block.ngb.north != EMPTY) {
+        const Block &ngb = blocks[block.ngb.north];
+        for(int i = 0; i < ni; ++i)
+            x[block.getExtID(i, nj)] = ngb.getIterate(src)[ngb.getExtID(i, 0)];
+    }
+
+    for(int i = 0; i < ni; ++i) {
+        for(int j = 0; j < nj; ++j) {
+            int c = j + i * nj;
+            int e = block.getExtID(i, j);
+            double sigma = block.coef_w[c] * x[e - stride] + block.coef_e[c] * x[e + stride]
+                         + block.coef_s[c] * x[e - 1] + block.coef_n[c] * x[e + 1];
+            double r = block.rhs[c] - sigma - block.coef_c[c] * x[e];
+
+            res(block.vec_id[c]) = r;
+            x_next[e] = x[e] + omega * r / block.coef_c[c];
+        }
+    }
+}
+
+void BlockJacobi::pack(Face &face, int src) {
+
+    Block &block = blocks[face.block];
+    const vector<double> &x = block.getIterate(src);
+    int length = face.snd_buf.size();
+
+    for(int k = 0; k < length; ++k) {
+        switch (face.side) {
+            case FACE_WEST:  face.snd_buf[k] = x[block.getExtID(0, k)]; break;
+            case FACE_EAST:  face.snd_buf[k] = x[block.getExtID(block.elts.i - 1, k)]; break;
+            case FACE_SOUTH: face.snd_buf[k] = x[block.getExtID(k, 0)]; break;
+            case FACE_NORTH: face.snd_buf[k] = x[block.getExtID(k, block.elts.j - 1)]; break;
+        }
+    }
+}
+
+void BlockJacobi::unpack(Face &face, int src) {
+
+    Block &block = blocks[face.block];
+    vector<double> &x = block.getIterate(src);
+    int length = face.rcv_buf.size();
+
+    for(int k = 0; k < length; ++k) {
+        switch (face.side) {
+            case FACE_WEST:  x[block.getExtID(-1, k)] = face.rcv_buf[k]; break;
+            case FACE_EAST:  x[block.getExtID(block.elts.i, k)] = face.rcv_buf[k]; break;
+            case FACE_SOUTH: x[block.getExtID(k, -1)] = face.rcv_buf[k]; break;
+            case FACE_NORTH: x[block.getExtID(k, block.elts.j)] = face.rcv_buf[k]; break;
+        }
+    }
+}
@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file block_jacobi.h
+ * @brief Contains declaration of the \e BlockJacobi class.
+ */
+
+#ifndef BLOCK_JACOBI_H_
+#define BLOCK_JACOBI_H_
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include <vector>
+#include "../DataTypes/vector.h"
+#include "../DataTypes/stencil.h"
+#include "../General/dimensions.h"
+#include "../General/structs.h"
+
+using namespace std;
+
+/*!
+ * @class BlockJacobi
+ * @brief Damped Jacobi iterations on a sub-domain split into several blocks.
+ *
+ * Every block keeps its own copy of the iterate with a halo of one cell. The
+ * halo of a block is copied from the blocks of the same process, while the
+ * faces along the cut lines arrive as messages from the blocks of the
+ * neighbors (see \e Decomposition::decomposeBlocks()). Every block is updated
+ * by an OpenMP task (or a task of the \e ThreadPool with USE_POOL) as soon as
+ * its halo is complete, so the blocks inside of the sub-domain are updated
+ * while the others wait for the messages.
+ *
+ * Several sweeps may also run as one graph of tasks (see \e sweepDataflow()).
+ * A task depends on the blocks it reads rather than on a barrier, so the
+ * blocks of the next sweeps are updated while the messages of a sweep are in
+ * flight.
+ *
+ * The cells of a block with the halo are enumerated as the local ones:
+ * (j + 1) + (i + 1) * (nj + 2). Halo cells on the physical boundary stay zero.
+ */
+class BlockJacobi {
+
+    enum {
+        FACE_WEST,
+        FACE_EAST,
+        FACE_SOUTH,
+        FACE_NORTH,
+    };
+
+    /* Block of the local sub-domain */
+    struct Block {
+        IndicesIJ elts;             // Number of real cells in each direction
+        Neighbors ngb;              // Neighboring blocks of the same process (EMPTY if none)
+        int num_remote = 0;         // Number of faces coupled to other processes
+        vector<int> vec_id;         // Vector ID of every real cell
+        vector<double> coef_c;      // Stencil of the real cells
+        vector<double> coef_w;
+        vector<double> coef_e;
+        vector<double> coef_s;
+        vector<double> coef_n;
+        vector<double> rhs;         // Right hand side of the real cells
+        vector<double> x;           // Current iterate with the halo
+        vector<double> x_next;      // Next iterate with the halo
+
+        inline int getExtID(int i, int j) const { return (j + 1) + (i + 1) * (elts.j + 2); }
+        inline vector<double> &getIterate(int k) { return (k == 0) ? x : x_next; }
+        inline const vector<double> &getIterate(int k) const { return (k == 0) ? x : x_next; }
+    };
+
+    /* Face of a block coupled to another process */
+    struct Face {
+        int block;                  // Index of the block
+        int side;                   // One of FACE_*
+        int pid;                    // Neighboring process
+        int tag;                    // Tag of the messages, index of the face along the cut line
+        vector<double> snd_buf;     // Real cells next to the face
+        vector<double> rcv_buf;     // Halo cells behind the face
+    };
+
+    IndicesIJ grid;                 // Number of blocks in each direction
+    vector<Block> blocks;           // Blocks, enumerated as bj + bi * grid.j
+    vector<Face> faces;             // Faces along the cut lines
+#ifdef USE_MPI
+    MPI_Comm comm;                  // Communicator of the neighbors
+    vector<MPI_Request> snd_requests;
+    vector<MPI_Request> rcv_requests;
+#endif
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    BlockJacobi();
+
+    /*!
+     * @brief Split the sub-domain into the blocks of its decomposition and
+     *        copy the stencil and the right hand side to them.
+     * @param stencil [in] Stencil of the local matrix
+     * @param dims [in] Dimensions of the problem
+     * @param b [in] Vector of right hand side
+     */
+    void setup(const Stencil &stencil, const Dimensions &dims, Vector &b);
+
+    /*!
+     * @brief Copy the real elements of the vector to the blocks.
+     * @param x [in] Vector of unknowns
+     */
+    void load(Vector &x);
+
+    /*!
+     * @brief Copy the real elements of the blocks to the vector.
+     * @param x [out] Vector of unknowns
+     */
+    void store(Vector &x);
+
+    /*!
+     * @brief Exchange the halo and perform one damped Jacobi sweep.
+     * The residual of the iterate the sweep starts from comes with the sweep
+     * for free.
+     * @note This is a collective call.
+     * @param omega [in] Relaxation factor
+     * @param res [out] Vector of residual of the current iterate
+     */
+    void sweep(double omega, Vector &res);
+
+    /*!
+     * @brief Perform several damped Jacobi sweeps as one graph of OpenMP tasks.
+     * The update of a block depends on the blocks it reads in the previous
+     * sweep and on its faces, the faces are sent and received by tasks of
+     * the same graph. The iterates alternate between the two buffers of the
+     * blocks, so there are no barriers between the sweeps. Without OpenMP
+     * (or with USE_POOL) the sweeps are performed one after another.
+     * @note This is a collective call. The tasks call MPI one at a time.
+     * @param num_sweeps [in] Number of sweeps
+     * @param omega [in] Relaxation factor
+     * @param res [out] Vector of residual of the iterate the last sweep starts from
+     */
+    void sweepDataflow(int num_sweeps, double omega, Vector &res);
+
+    /*!
+     * @brief Return the number of blocks of the sub-domain.
+     */
+    inline int getNumBlocks() const { return blocks.size(); }
+
+private:
+    /*!
+     * @brief Spawn the update of the block of the current iterate as an OpenMP
+     *        task, or as a task of the \e ThreadPool with USE_POOL.
+     * @param b [in] Index of the block
+     * @param omega [in] Relaxation factor
+     * @param res [out] Vector of residual of the current iterate
+     */
+    void spawnBlock(int b, double omega, Vector &res);
+
+    /*!
+     * @brief Copy the halo from the blocks of the same process and update
+     *        the block.
+     * @param b [in] Index of the block
+     * @param src [in] Buffer of the current iterate (0 for x, 1 for x_next)
+     * @param omega [in] Relaxation factor
+     * @param res [out] Vector of residual of the current iterate
+     */
+    void updateBlock(int b, int src, double omega, Vector &res);
+
+    /*!
+     * @brief Copy the real cells next to the face to its send buffer.
+     * @param src [in] Buffer of the current iterate
+     */
+    void pack(Face &face, int src);
+
+    /*!
+     * @brief Copy the receive buffer of the face to the halo of its block.
+     * @param src [in] Buffer of the current iterate
+     */
+    void unpack(Face &face, int src);
+};
+
+#endif /* BLOCK_JACOBI_H_ */
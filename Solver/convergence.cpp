@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file convergence.cpp
+ * @brief Contains definitions of methods from the \e ConvergenceDetector class.
+ */
+
+#include "convergence.h"
+
+ConvergenceDetector::ConvergenceDetector() : active(false) {
+
+    values[0] = values[1] = 0.0;
+    result[0] = result[1] = 0.0;
+#ifdef USE_MPI
+    request = MPI_REQUEST_NULL;
+#endif
+}
+
+void ConvergenceDetector::start(double residual_sqr, bool exhausted) {
+
+    values[0] = residual_sqr;
+    values[1] = exhausted ? 1.0 : 0.0;
+    active = true;
+
+#ifdef USE_MPI
+    MPI_Iallreduce(values, result, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD, &request);
+#else
+    result[0] = values[0];
+    result[1] = values[1];
+#endif
+}
+
+bool ConvergenceDetector::test(double &residual_sqr, bool &exhausted) {
+
+    if (!active)
+        return false;
+
+#ifdef USE_MPI
+    int flag = 0;
+    MPI_Test(&request, &flag, MPI_STATUS_IGNORE);
+    if (!flag)
+        return false;
+#endif
+
+    active = false;
+    residual_sqr = result[0];
+    exhausted = result[1] > 0.0;
+
+    return true;
+}
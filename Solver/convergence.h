@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file convergence.h
+ * @brief Contains declaration of the \e ConvergenceDetector class.
+ */
+
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+
+/*!
+ * @class ConvergenceDetector
+ * @brief Distributed convergence detection of asynchronous iterations.
+ *
+ * Every process contributes its local squared residual and a flag telling
+ * whether it ran out of iterations. The contributions are summed by a
+ * nonblocking reduction, so processes keep iterating while it is in flight.
+ * A new reduction is started only after the previous one has completed, hence
+ * all processes see the same sequence of results and stop at the same one.
+ */
+class ConvergenceDetector {
+    double values[2];       // Local contributions: squared residual and flag
+    double result[2];       // Sums over all processes
+    bool active;            // True while a reduction is in flight
+#ifdef USE_MPI
+    MPI_Request request;    // Request of the reduction in flight
+#endif
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    ConvergenceDetector();
+
+    ConvergenceDetector(const ConvergenceDetector&) = delete;
+    ConvergenceDetector& operator=(const ConvergenceDetector&) = delete;
+
+    /*!
+     * @brief Check whether a reduction is in flight.
+     */
+    inline bool isActive() const { return active; }
+
+    /*!
+     * @brief Start the reduction of the local contributions.
+     * @note This is a collective call.
+     * @param residual_sqr [in] Local squared residual
+     * @param exhausted [in] True if the process reached the iteration limit
+     */
+    void start(double residual_sqr, bool exhausted);
+
+    /*!
+     * @brief Check whether the reduction has completed.
+     * @param residual_sqr [out] Global squared residual
+     * @param exhausted [out] True if any process reached the iteration limit
+     * @return True if the reduction has completed, false otherwise.
+     */
+    bool test(double &residual_sqr, bool &exhausted);
+};
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file deep_halo.cpp
+ * @brief Contains definitions of methods from the \e DeepHalo class.
+ */
+
+#include <algorithm>
+#include "deep_halo.h"
+#include "../MPI/common.h"
+#include "../MPI/threads.h"
+
+#define TAG_DEEP_WE 400
+#define TAG_DEEP_SN 401
+
+DeepHalo::DeepHalo() : depth(0), loc(0, 0), elts(0, 0) {
+
+#ifdef USE_MPI
+    comm = MPI_COMM_NULL;
+    type_we = MPI_DATATYPE_NULL;
+    type_sn = MPI_DATATYPE_NULL;
+#endif
+}
+
+DeepHalo& DeepHalo::operator=(const DeepHalo &other) {
+
+    if (this != &other)
+        clear();
+
+    return *this;
+}
+
+DeepHalo::~DeepHalo() {
+
+    clear();
+}
+
+void DeepHalo::clear() {
+
+#ifdef USE_MPI
+    int finalized = 0;
+
+    MPI_Finalized(&finalized);
+    if (!finalized) {
+        if (type_we != MPI_DATATYPE_NULL)
+            MPI_Type_free(&type_we);
+        if (type_sn != MPI_DATATYPE_NULL)
+            MPI_Type_free(&type_sn);
+    }
+    type_we = MPI_DATATYPE_NULL;
+    type_sn = MPI_DATATYPE_NULL;
+    comm = MPI_COMM_NULL;
+#endif
+    depth = 0;
+}
+
+int DeepHalo::setup(const Stencil &stencil, const Dimensions &dims, int in_depth, Vector &b) {
+
+    int loc_size = stencil.size();
+    int size = 0;
+    int thin = 0;                   // Number of sub-domains thinner than the halo
+
+    clear();
+
+    depth = in_depth;
+    loc = stencil.getNumElts();
+    elts.i = loc.i + 2 * depth;
+    elts.j = loc.j + 2 * depth;
+    size = elts.i * elts.j;
+    ngb_pid = dims.getDecomposition().getNgbPid();
+
+    /* The layers of the halo have to come from the nearest neighbors. */
+    if ((ngb_pid.west != EMPTY || ngb_pid.east != EMPTY) && loc.i < depth)
+        thin = 1;
+    if ((ngb_pid.south != EMPTY || ngb_pid.north != EMPTY) && loc.j < depth)
+        thin = 1;
+    findGlobalSum(thin);
+    if (thin > 0)
+        return EXIT_FAILURE;
+
+#ifdef USE_MPI
+    comm = dims.getDecomposition().getCommunicator();
+    MPI_Type_vector(depth, loc.j, elts.j, MPI_DOUBLE, &type_we);
+    MPI_Type_commit(&type_we);
+    MPI_Type_vector(elts.i, depth, elts.j, MPI_DOUBLE, &type_sn);
+    MPI_Type_commit(&type_sn);
+#endif
+
+    /* Corners are active if both of the neighbors next to them exist. */
+    active.assign(size, 0);
+    for(int i = -depth; i < loc.i + depth; ++i) {
+        for(int j = -depth; j < loc.j + depth; ++j) {
+            bool inside = (i >= 0 || ngb_pid.west != EMPTY) && (i < loc.i || ngb_pid.east != EMPTY)
+                       && (j >= 0 || ngb_pid.south != EMPTY) && (j < loc.j || ngb_pid.north != EMPTY);
+            active[getExtID(i, j)] = inside ? 1 : 0;
+        }
+    }
+
+    /* Couplings to the physical boundary are dropped. */
+    coef_c.assign(size, 0.0);
+    coef_w.assign(size, 0.0);
+    coef_e.assign(size, 0.0);
+    coef_s.assign(size, 0.0);
+    coef_n.assign(size, 0.0);
+    rhs.assign(size, 0.0);
+    vec_id.assign(size, EMPTY);
+    for(int i = 0; i < loc.i; ++i) {
+        for(int j = 0; j < loc.j; ++j) {
+            int n = stencil.getID(i, j);
+            int e = getExtID(i, j);
+
+            vec_id[e] = n;
+            coef_c[e] = stencil.getCentral(n);
+            rhs[e] = b(n);
+            if (stencil.getIdWest(n) != EMPTY)
+                coef_w[e] = stencil.getWest(n);
+            if (stencil.getIdEast(n) != EMPTY)
+                coef_e[e] = stencil.getEast(n);
+            if (stencil.getIdSouth(n) != EMPTY)
+                coef_s[e] = stencil.getSouth(n);
+            if (stencil.getIdNorth(n) != EMPTY)
+                coef_n[e] = stencil.getNorth(n);
+
+            if (stencil.getIdWest(n) >= loc_size)
+                vec_id[getExtID(i - 1, j)] = stencil.getIdWest(n);
+            if (stencil.getIdEast(n) >= loc_size)
+                vec_id[getExtID(i + 1, j)] = stencil.getIdEast(n);
+            if (stencil.getIdSouth(n) >= loc_size)
+                vec_id[getExtID(i, j - 1)] = stencil.getIdSouth(n);
+            if (stencil.getIdNorth(n) >= loc_size)
+                vec_id[getExtID(i, j + 1)] = stencil.getIdNorth(n);
+        }
+    }
+
+    /* The neighbors send the rows of the matrix along with the halo. */
+    exchange(coef_c);
+    exchange(coef_w);
+    exchange(coef_e);
+    exchange(coef_s);
+    exchange(coef_n);
+    exchange(rhs);
+
+    x_ext.assign(size, 0.0);
+    x_next.assign(size, 0.0);
+
+    return EXIT_SUCCESS;
+}
+
+void DeepHalo::load(Vector &x) {
+
+#pragma omp parallel for
+    for(int i = 0; i < loc.i; ++i) {
+        for(int j = 0; j < loc.j; ++j) {
+            int e = getExtID(i, j);
+            x_ext[e] = x(vec_id[e]);
+        }
+    }
+}
+
+void DeepHalo::store(Vector &x) {
+
+    int size = elts.i * elts.j;
+
+#pragma omp parallel for
+    for(int e = 0; e < size; ++e) {
+        if (vec_id[e] != EMPTY)
+            x(vec_id[e]) = x_ext[e];
+    }
+}
+
+void DeepHalo::sweep(double omega, int num_sweeps) {
+
+    for(int s = 0; s < num_sweeps; ++s) {
+        /* Cells up to `reach` layers away from the real ones still get valid values. */
+        int reach = num_sweeps - 1 - s;
+
+#pragma omp parallel for
+        for(int i = -reach; i < loc.i + reach; ++i) {
+            for(int j = -reach; j < loc.j + reach; ++j) {
+                int e = getExtID(i, j);
+                if (!active[e])
+                    continue;
+                double sigma = coef_w[e] * x_ext[e - elts.j] + coef_e[e] * x_ext[e + elts.j]
+                             + coef_s[e] * x_ext[e - 1] + coef_n[e] * x_ext[e + 1];
+                double x_jac = (rhs[e] - sigma) / coef_c[e];
+                x_next[e] = x_ext[e] + omega * (x_jac - x_ext[e]);
+            }
+        }
+
+        x_ext.swap(x_next);
+    }
+}
+
+void DeepHalo::exchange(vector<double> &data) {
+
+#if defined(USE_THREADS)
+    /* The mailboxes keep copies of the messages, so the sends return immediately. */
+    if (ngb_pid.west != EMPTY)
+        sendLayers(data, ngb_pid.west, TAG_DEEP_WE, 0, 0, depth, loc.j);
+    if (ngb_pid.east != EMPTY)
+        sendLayers(data, ngb_pid.east, TAG_DEEP_WE, loc.i - depth, 0, depth, loc.j);
+    if (ngb_pid.west != EMPTY)
+        recvLayers(data, ngb_pid.west, TAG_DEEP_WE, -depth, 0, depth, loc.j);
+    if (ngb_pid.east != EMPTY)
+        recvLayers(data, ngb_pid.east, TAG_DEEP_WE, loc.i, 0, depth, loc.j);
+
+    /* South/north layers along the whole extended i-range, including the corners */
+    if (ngb_pid.south != EMPTY)
+        sendLayers(data, ngb_pid.south, TAG_DEEP_SN, -depth, 0, elts.i, depth);
+    if (ngb_pid.north != EMPTY)
+        sendLayers(data, ngb_pid.north, TAG_DEEP_SN, -depth, loc.j - depth, elts.i, depth);
+    if (ngb_pid.south != EMPTY)
+        recvLayers(data, ngb_pid.south, TAG_DEEP_SN, -depth, -depth, elts.i, depth);
+    if (ngb_pid.north != EMPTY)
+        recvLayers(data, ngb_pid.north, TAG_DEEP_SN, -depth, loc.j, elts.i, depth);
+#elif defined(USE_MPI)
+    double *ptr = data.data();
+    MPI_Request requests[4];
+
+    /* West/east layers along the real j-range */
+    for(int r = 0; r < 4; ++r) {
+        requests[r] = MPI_REQUEST_NULL;
+    }
+    if (ngb_pid.west != EMPTY) {
+        MPI_Irecv(ptr + getExtID(-depth, 0), 1, type_we, ngb_pid.west, TAG_DEEP_WE, comm,
+                  &requests[0]);
+        MPI_Isend(ptr + getExtID(0, 0), 1, type_we, ngb_pid.west, TAG_DEEP_WE, comm,
+                  &requests[1]);
+    }
+    if (ngb_pid.east != EMPTY) {
+        MPI_Irecv(ptr + getExtID(loc.i, 0), 1, type_we, ngb_pid.east, TAG_DEEP_WE, comm,
+                  &requests[2]);
+        MPI_Isend(ptr + getExtID(loc.i - depth, 0), 1, type_we, ngb_pid.east, TAG_DEEP_WE, comm,
+                  &requests[3]);
+    }
+    MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+
+    /* South/north layers along the whole extended i-range, including the corners */
+    if (ngb_pid.south != EMPTY) {
+        MPI_Irecv(ptr + getExtID(-depth, -depth), 1, type_sn, ngb_pid.south, TAG_DEEP_SN, comm,
+                  &requests[0]);
+        MPI_Isend(ptr + getExtID(-depth, 0), 1, type_sn, ngb_pid.south, TAG_DEEP_SN, comm,
+                  &requests[1]);
+    }
+    if (ngb_pid.north != EMPTY) {
+        MPI_Irecv(ptr + getExtID(-depth, loc.j), 1, type_sn, ngb_pid.north, TAG_DEEP_SN, comm,
+                  &requests[2]);
+        MPI_Isend(ptr + getExtID(-depth, loc.j - depth), 1, type_sn, ngb_pid.north, TAG_DEEP_SN,
+                  comm, &requests[3]);
+    }
+    MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+#endif
+}
+
+#ifdef USE_THREADS
+void DeepHalo::sendLayers(const vector<double> &data, int dest, int tag, int i_beg, int j_beg,
+                          int num_i, int num_j) {
+
+    vector<double> buffer(num_i * num_j);
+
+    for(int i = 0; i < num_i; ++i)
+        for(int j = 0; j < num_j; ++j)
+            buffer[j + i * num_j] = data[getExtID(i_beg + i, j_beg + j)];
+    threadSend(dest, tag, buffer.data(), buffer.size());
+}
+
+void DeepHalo::recvLayers(vector<double> &data, int source, int tag, int i_beg, int j_beg,
+                          int num_i, int num_j) {
+
+    vector<double> buffer(num_i * num_j);
+
+    threadRecv(source, tag, buffer.data(), buffer.size());
+    for(int i = 0; i < num_i; ++i)
+        for(int j = 0; j < num_j; ++j)
+            data[getExtID(i_beg + i, j_beg + j)] = buffer[j + i * num_j];
+}
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file deep_halo.h
+ * @brief Contains declaration of the \e DeepHalo class.
+ */
+
+#ifndef DEEP_HALO_H_
+#define DEEP_HALO_H_
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include <vector>
+#include "../DataTypes/vector.h"
+#include "../DataTypes/stencil.h"
+#include "../General/dimensions.h"
+#include "../General/structs.h"
+
+using namespace std;
+
+/*!
+ * @class DeepHalo
+ * @brief Damped Jacobi iterations on the sub-domain extended by a halo of
+ *        several cells.
+ *
+ * The halo of depth k is exchanged once per k sweeps. Every sweep updates
+ * the halo cells redundantly, one layer less than the previous one, so after
+ * k sweeps the real cells hold exactly the k-th Jacobi iterate. This trades
+ * some extra computation for k times fewer messages.
+ *
+ * The extended grid has k more layers of cells on each side of the local
+ * grid, its cells are enumerated as the local ones: j + i * (nj + 2k). The
+ * halo is exchanged in two phases, first with the west/east neighbors and
+ * then with the south/north ones including the fresh west/east layers, so
+ * the corner cells arrive without diagonal messages. Cells outside of the
+ * global domain are inactive and stay zero.
+ */
+class DeepHalo {
+    int depth;                      // Number of halo layers
+    IndicesIJ loc;                  // Number of real cells in each direction
+    IndicesIJ elts;                 // Number of cells of the extended grid in each direction
+    Neighbors ngb_pid;              // Neighboring sub-domains
+    vector<int> vec_id;             // Vector ID of every extended cell, EMPTY if it's
+                                    // neither a real nor a regular halo cell
+    vector<char> active;            // Extended cells inside of the global domain
+    vector<double> coef_c;          // Stencil of the extended cells
+    vector<double> coef_w;
+    vector<double> coef_e;
+    vector<double> coef_s;
+    vector<double> coef_n;
+    vector<double> rhs;             // Right hand side of the extended cells
+    vector<double> x_ext;           // Current iterate on the extended grid
+    vector<double> x_next;          // Next iterate on the extended grid
+#ifdef USE_MPI
+    MPI_Comm comm;                  // Communicator of the neighbors
+    MPI_Datatype type_we;           // Layers exchanged with the west/east neighbors
+    MPI_Datatype type_sn;           // Layers exchanged with the south/north neighbors
+#endif
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    DeepHalo();
+
+    /*!
+     * @brief Copy constructor, creates an empty object to be set up again.
+     */
+    DeepHalo(const DeepHalo&) : DeepHalo() { }
+
+    /*!
+     * @brief Assignment operator, leaves the object empty.
+     */
+    DeepHalo& operator=(const DeepHalo &other);
+
+    /*!
+     * @brief Destructor, frees the datatypes.
+     */
+    ~DeepHalo();
+
+    /*!
+     * @brief Build the extended grid and exchange the stencil and the right
+     *        hand side of its cells.
+     * @note This is a collective call.
+     * @param stencil [in] Stencil of the local matrix
+     * @param dims [in] Dimensions of the problem
+     * @param in_depth [in] Number of halo layers
+     * @param b [in] Vector of right hand side
+     * @return EXIT_FAILURE if a sub-domain is thinner than the halo,
+     *         EXIT_SUCCESS otherwise.
+     */
+    int setup(const Stencil &stencil, const Dimensions &dims, int in_depth, Vector &b);
+
+    /*!
+     * @brief Copy the real elements of the vector to the extended grid.
+     * @param x [in] Vector of unknowns
+     */
+    void load(Vector &x);
+
+    /*!
+     * @brief Copy the real and the regular halo elements of the extended grid
+     *        to the vector.
+     * @note The halo should be exchanged since the last sweeps.
+     * @param x [out] Vector of unknowns
+     */
+    void store(Vector &x);
+
+    /*!
+     * @brief Exchange the halo of the current iterate.
+     * @note This is a collective call.
+     */
+    inline void exchange() { exchange(x_ext); }
+
+    /*!
+     * @brief Perform the damped Jacobi sweeps between two exchanges.
+     * @note The halo should be exchanged since the last sweeps.
+     * @param omega [in] Relaxation factor
+     * @param num_sweeps [in] Number of sweeps, not more than the depth of the halo
+     */
+    void sweep(double omega, int num_sweeps);
+
+    /*!
+     * @brief Return the number of halo layers.
+     */
+    inline int getDepth() const { return depth; }
+
+private:
+    /*!
+     * @brief Return ID of the extended cell from indices of the local grid.
+     */
+    inline int getExtID(int i, int j) const { return (j + depth) + (i + depth) * elts.j; }
+
+    /*!
+     * @brief Exchange the halo of an array defined on the extended grid.
+     * @param data [in/out] Elements of the extended grid
+     */
+    void exchange(vector<double> &data);
+
+#ifdef USE_THREADS
+    /*!
+     * @brief Send a rectangle of the extended grid to the neighbor through its
+     *        mailbox.
+     * @param data [in] Elements of the extended grid
+     * @param dest [in] Rank of the neighbor
+     * @param tag [in] Tag of the message
+     * @param i_beg [in] First i-index of the rectangle
+     * @param j_beg [in] First j-index of the rectangle
+     * @param num_i [in] Number of cells of the rectangle along i
+     * @param num_j [in] Number of cells of the rectangle along j
+     */
+    void sendLayers(const vector<double> &data, int dest, int tag, int i_beg, int j_beg,
+                    int num_i, int num_j);
+
+    /*!
+     * @brief Receive a rectangle of the extended grid from the neighbor.
+     * @param data [in/out] Elements of the extended grid
+     * @param source [in] Rank of the neighbor
+     * @param tag [in] Tag of the message
+     * @param i_beg [in] First i-index of the rectangle
+     * @param j_beg [in] First j-index of the rectangle
+     * @param num_i [in] Number of cells of the rectangle along i
+     * @param num_j [in] Number of cells of the rectangle along j
+     */
+    void recvLayers(vector<double> &data, int source, int tag, int i_beg, int j_beg,
+                    int num_i, int num_j);
+#endif
+
+    /*!
+     * @brief Free the datatypes.
+     */
+    void clear();
+};
+
+#endif /* DEEP_HALO_H_ */
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file load_balancer.cpp
+ * @brief Contains definitions of methods from the \e LoadBalancer class.
+ */
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include "load_balancer.h"
+
+using namespace std;
+
+bool LoadBalancer::check(int iter, const Dimensions &dims, Dimensions &new_dims) {
+
+    double max_time = local_time;
+    double mean_time = local_time;
+    double throughput = 0.0;
+    IndicesIJ elts_loc = dims.getNumEltsLoc();
+
+    if (!isEnabled() || (iter + 1) % interval != 0)
+        return false;
+
+    findGlobalMax(max_time);
+    findGlobalSum(mean_time);
+    mean_time /= getNumProcs();
+
+    throughput = elts_loc.i * elts_loc.j / max(local_time, 1e-12);
+    local_time = 0.0;
+
+    if (max_time <= threshold * mean_time)
+        return false;
+
+    printByRoot("Load imbalance " + std::to_string(max_time / mean_time)
+                + ", moving the cut lines.");
+
+    new_dims = dims;
+    new_dims.setWeight(throughput);
+    if (new_dims.decompose(dims.getDecomposition().getNumSubdomains()) == EXIT_FAILURE)
+        return false;
+
+    return true;
+}
+
+void LoadBalancer::migrate(const Dimensions &new_dims, Vector &vec) {
+
+#ifdef USE_MPI
+    Dimensions old_dims = vec.getDimensions();
+    int num_procs = getNumProcs();
+    /* Blocks of the cells of every process: old (beg i, size i, beg j, size j), then new */
+    int block[8] = {old_dims.getBegIndicesGlob().i, old_dims.getNumEltsLoc().i,
+                    old_dims.getBegIndicesGlob().j, old_dims.getNumEltsLoc().j,
+                    new_dims.getBegIndicesGlob().i, new_dims.getNumEltsLoc().i,
+                    new_dims.getBegIndicesGlob().j, new_dims.getNumEltsLoc().j};
+    vector<int> blocks(8 * num_procs);
+    vector<int> snd_counts(num_procs, 0), snd_displs(num_procs, 0);
+    vector<int> rcv_counts(num_procs, 0), rcv_displs(num_procs, 0);
+    vector<double> snd_buf, rcv_buf;
+
+    MPI_Allgather(block, 8, MPI_INT, blocks.data(), 8, MPI_INT, MPI_COMM_WORLD);
+
+    /*
+     * Both sides walk the intersection of the old block of the sender and the
+     * new block of the receiver in the same order (i-major), so the elements
+     * need no indices.
+     */
+    for(int p = 0; p < num_procs; ++p) {
+        const int *old_block = &block[0];
+        const int *new_block = &blocks[8 * p + 4];
+        int beg_i = max(old_block[0], new_block[0]);
+        int end_i = min(old_block[0] + old_block[1], new_block[0] + new_block[1]);
+        int beg_j = max(old_block[2], new_block[2]);
+        int end_j = min(old_block[2] + old_block[3], new_block[2] + new_block[3]);
+
+        snd_displs[p] = snd_buf.size();
+        for(int i = beg_i; i < end_i; ++i) {
+            for(int j = beg_j; j < end_j; ++j) {
+                snd_buf.push_back(vec((j - old_block[2]) + (i - old_block[0]) * old_block[3]));
+            }
+        }
+        snd_counts[p] = snd_buf.size() - snd_displs[p];
+    }
+
+    for(int p = 0; p < num_procs; ++p) {
+        const int *old_block = &blocks[8 * p];
+        const int *new_block = &block[4];
+        int size_i = min(old_block[0] + old_block[1], new_block[0] + new_block[1])
+                   - max(old_block[0], new_block[0]);
+        int size_j = min(old_block[2] + old_block[3], new_block[2] + new_block[3])
+                   - max(old_block[2], new_block[2]);
+
+        rcv_counts[p] = max(size_i, 0) * max(size_j, 0);
+        rcv_displs[p] = (p > 0) ? rcv_displs[p - 1] + rcv_counts[p - 1] : 0;
+    }
+    rcv_buf.resize(rcv_displs[num_procs - 1] + rcv_counts[num_procs - 1]);
+
+    MPI_Alltoallv(snd_buf.data(), snd_counts.data(), snd_displs.data(), MPI_DOUBLE,
+                  rcv_buf.data(), rcv_counts.data(), rcv_displs.data(), MPI_DOUBLE,
+                  MPI_COMM_WORLD);
+
+    vec.resize(new_dims);
+    for(int p = 0; p < num_procs; ++p) {
+        const int *old_block = &blocks[8 * p];
+        const int *new_block = &block[4];
+        int beg_i = max(old_block[0], new_block[0]);
+        int end_i = min(old_block[0] + old_block[1], new_block[0] + new_block[1]);
+        int beg_j = max(old_block[2], new_block[2]);
+        int end_j = min(old_block[2] + old_block[3], new_block[2] + new_block[3]);
+        int k = rcv_displs[p];
+
+        for(int i = beg_i; i < end_i; ++i) {
+            for(int j = beg_j; j < end_j; ++j) {
+                vec((j - new_block[2]) + (i - new_block[0]) * new_block[3]) = rcv_buf[k++];
+            }
+        }
+    }
+#else
+    vec.resize(new_dims);
+#endif
+}
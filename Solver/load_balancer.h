@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file load_balancer.h
+ * @brief Contains declaration of the \e LoadBalancer class.
+ */
+
+#ifndef LOAD_BALANCER_H
+#define LOAD_BALANCER_H
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include "../DataTypes/vector.h"
+#include "../General/dimensions.h"
+
+/*!
+ * @class LoadBalancer
+ * @brief Dynamic balancing of the load between the processes.
+ *
+ * The time of the local work, i.e. of the operations without communication,
+ * is measured during the iterations. Every few iterations the processes
+ * compare their times, and if the slowest one is too far above the mean, the
+ * domain is decomposed again with the weights equal to the measured
+ * throughputs (see \e Decomposition::decompose()). The vectors are then
+ * moved to the new decomposition by \e migrate().
+ */
+class LoadBalancer {
+    int interval;           // Number of iterations between the checks, 0 disables balancing
+    double threshold;       // Ratio of the largest to the mean time that triggers balancing
+    double local_time;      // Time of the local work since the last check
+    double start_time;      // Start of the current measurement
+
+public:
+    /*!
+     * @brief Default constructor, balancing is disabled.
+     */
+    LoadBalancer() : interval(0), threshold(1.1), local_time(0.0), start_time(0.0) { }
+
+    /*!
+     * @brief Set the number of iterations between the checks.
+     * @param in_interval [in] Number of iterations, 0 disables balancing
+     */
+    inline void setInterval(int in_interval) { interval = in_interval; }
+
+    /*!
+     * @brief Check whether balancing is enabled, it makes sense with several
+     *        processes only.
+     */
+    inline bool isEnabled() const { return interval > 0 && getNumProcs() > 1; }
+
+    /*!
+     * @brief Start measuring the local work.
+     */
+    inline void startTimer() {
+#ifdef USE_MPI
+        start_time = MPI_Wtime();
+#endif
+    }
+
+    /*!
+     * @brief Stop measuring the local work.
+     */
+    inline void stopTimer() {
+#ifdef USE_MPI
+        local_time += MPI_Wtime() - start_time;
+#endif
+    }
+
+    /*!
+     * @brief Check the balance of the load after the given iteration and
+     *        find the new decomposition if it is needed.
+     * @note This is a collective call.
+     * @param iter [in] Number of the iteration
+     * @param dims [in] Current dimensions of the problem
+     * @param new_dims [out] New dimensions of the problem
+     * @return True if the problem should be moved to the new dimensions.
+     */
+    bool check(int iter, const Dimensions &dims, Dimensions &new_dims);
+
+    /*!
+     * @brief Move the real elements of the vector to the new decomposition.
+     * The vector is resized, its halo elements are not exchanged.
+     * @note This is a collective call.
+     * @param new_dims [in] New dimensions of the problem
+     * @param vec [in/out] Vector to move
+     */
+    static void migrate(const Dimensions &new_dims, Vector &vec);
+};
+
+#endif
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file relaxation.cpp
+ * @brief Contains definitions of methods from the \e Relaxation class.
+ */
+
+#include <cmath>
+#include "relaxation.h"
+
+/* Relative variation of the rate that is still considered as constant. */
+#define RATE_VARIATION 1e-3
+/* Number of iterations with a constant rate before the estimate is trusted. */
+#define RATE_SETTLED_ITERS 5
+/* Minimal relative change of the relaxation factor worth applying. */
+#define OMEGA_VARIATION 1e-3
+
+bool Relaxation::isRateSettled(double residual, double &rate) {
+
+    rate = (residual_old > 0.0) ? residual / residual_old : 1.;
+    residual_old = residual;
+
+    if (rate < 1. && fabs(rate - rate_old) < RATE_VARIATION * rate)
+        ++settled_iters;
+    else
+        settled_iters = 0;
+    rate_old = rate;
+
+    return settled_iters >= RATE_SETTLED_ITERS;
+}
+
+bool Relaxation::updateJacobi(double residual, int num_sweeps) {
+
+    double rate = 1.;
+    double lambda_min = 0.0;
+    double omega_new = omega;
+
+    if (!isRateSettled(residual, rate))
+        return false;
+
+    rate = pow(rate, 1. / num_sweeps);
+    lambda_min = (1. - rate) / omega;
+    omega_new = 2. / (lambda_min + lambda_max);
+
+    if (fabs(omega_new - omega) < OMEGA_VARIATION * omega)
+        return false;
+
+    /* Let the new rate settle before the next estimate. */
+    omega = omega_new;
+    settled_iters = 0;
+    return true;
+}
+
+bool Relaxation::updateSOR(double residual) {
+
+    double rate = 1.;
+    double mu_sqr = 0.0;
+    double omega_new = omega;
+
+    if (!isRateSettled(residual, rate))
+        return false;
+
+    mu_sqr = (rate + omega - 1.) * (rate + omega - 1.) / (rate * omega * omega);
+    if (mu_sqr >= 1.)
+        return false;
+    omega_new = 2. / (1. + sqrt(1. - mu_sqr));
+
+    if (omega_new < omega * (1. + OMEGA_VARIATION))
+        return false;
+
+    omega = omega_new;
+    settled_iters = 0;
+    return true;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file relaxation.h
+ * @brief Contains declaration of the \e Relaxation class.
+ */
+
+#ifndef RELAXATION_H_
+#define RELAXATION_H_
+
+/*!
+ * @class Relaxation
+ * @brief Tunes the relaxation factor from the observed convergence rate.
+ *
+ * Once the residual reduction rate q settles, it is used to estimate the
+ * spectrum of the iteration and to update the relaxation factor:
+ *  - for damped Jacobi, q = 1 - omega * lambda_min gives the smallest
+ *    eigenvalue of \f[ D^{-1} A \f]; together with an upper bound lambda_max
+ *    of the spectrum the best factor is 2 / (lambda_min + lambda_max);
+ *  - for SOR, the spectral radius mu of the Jacobi iteration follows from
+ *    (q + omega - 1)^2 = q omega^2 mu^2 (Hageman & Young) and the optimal
+ *    factor is 2 / (1 + sqrt(1 - mu^2)). The estimate of mu is a lower bound
+ *    as long as omega is below optimal, so omega is only increased.
+ */
+class Relaxation {
+    double omega;           // Current relaxation factor
+    double lambda_max;      // Upper bound of the spectrum of D^-1 A
+    double residual_old;    // Residual at the previous iteration
+    double rate_old;        // Reduction rate at the previous iteration
+    int settled_iters;      // Number of iterations the rate stayed constant
+
+public:
+    /*!
+     * @brief Constructor.
+     * @param initial_omega [in] Relaxation factor to start with
+     */
+    Relaxation(double initial_omega) : omega(initial_omega), lambda_max(2.),
+                                       residual_old(0.0), rate_old(0.0),
+                                       settled_iters(0) { }
+
+    /*!
+     * @brief Set the upper bound of the spectrum of \f[ D^{-1} A \f].
+     * @param bound [in] Upper bound, e.g. from the Gershgorin theorem
+     */
+    inline void setSpectrumBound(double bound) { lambda_max = bound; }
+
+    /*!
+     * @brief Return the current relaxation factor.
+     */
+    inline double getOmega() const { return omega; }
+
+    /*!
+     * @brief Update the relaxation factor of the damped Jacobi method.
+     * @param residual [in] Residual norm at the current iteration
+     * @param num_sweeps [in] Number of sweeps since the previous residual
+     * @return True if the relaxation factor was changed
+     */
+    bool updateJacobi(double residual, int num_sweeps = 1);
+
+    /*!
+     * @brief Update the relaxation factor of the SOR method.
+     * @param residual [in] Residual norm at the current iteration
+     * @return True if the relaxation factor was changed
+     */
+    bool updateSOR(double residual);
+
+private:
+    /*!
+     * @brief Check whether the reduction rate has settled.
+     * @param residual [in] Residual norm at the current iteration
+     * @param rate [out] Current reduction rate
+     * @return True if the rate stayed constant long enough
+     */
+    bool isRateSettled(double residual, double &rate);
+};
+
+#endif /* RELAXATION_H_ */
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file schwarz.cpp
+ * @brief Contains definitions of methods from the \e Schwarz class.
+ */
+
+#include "schwarz.h"
+
+int Schwarz::setup(const Stencil &stencil, const Dimensions &dims) {
+
+    IndicesIJ loc = stencil.getNumElts();
+    int loc_size = stencil.size();
+    int size = 0;
+    int bandwidth = 0;              // Number of sub-diagonals of the extended matrix
+    int width = 0;                  // Number of stored elements per row
+    Vector coef_c, coef_w, coef_s;
+
+    elts.i = loc.i + 2;
+    elts.j = loc.j + 2;
+    size = elts.i * elts.j;
+    bandwidth = elts.j;
+    width = bandwidth + 1;
+
+    /*
+     * The neighbors send the rows of their on-border cells as regular halos.
+     * The matrix is symmetric, so the lower band is enough.
+     */
+    coef_c.resize(dims);
+    coef_w.resize(dims);
+    coef_s.resize(dims);
+    for(int n = 0; n < loc_size; ++n) {
+        coef_c(n) = stencil.getCentral(n);
+        coef_w(n) = stencil.getWest(n);
+        coef_s(n) = stencil.getSouth(n);
+    }
+    coef_c.exchangeRealHalo();
+    coef_w.exchangeRealHalo();
+    coef_s.exchangeRealHalo();
+
+    /* Real cells and the halo cells next to them are active. */
+    vec_id.assign(size, EMPTY);
+    for(int i = 0; i < loc.i; ++i) {
+        for(int j = 0; j < loc.j; ++j) {
+            int n = stencil.getID(i, j);
+
+            vec_id[getExtID(i, j)] = n;
+            if (stencil.getIdWest(n) >= loc_size)
+                vec_id[getExtID(i - 1, j)] = stencil.getIdWest(n);
+            if (stencil.getIdEast(n) >= loc_size)
+                vec_id[getExtID(i + 1, j)] = stencil.getIdEast(n);
+            if (stencil.getIdSouth(n) >= loc_size)
+                vec_id[getExtID(i, j - 1)] = stencil.getIdSouth(n);
+            if (stencil.getIdNorth(n) >= loc_size)
+                vec_id[getExtID(i, j + 1)] = stencil.getIdNorth(n);
+        }
+    }
+
+    /*
+     * Lower band of the extended matrix: the south neighbor is the previous
+     * cell, the west one is a whole line of cells away. Inactive cells get
+     * identity rows, couplings to them are dropped.
+     */
+    vector<double> band(size * width, 0.0);
+    for(int i = 0; i < elts.i; ++i) {
+        for(int j = 0; j < elts.j; ++j) {
+            int e = j + i * elts.j;
+            int v = vec_id[e];
+
+            if (v == EMPTY) {
+                band[bandwidth + e * width] = 1.0;
+                continue;
+            }
+
+            band[bandwidth + e * width] = coef_c(v);
+            if (i > 0 && vec_id[e - elts.j] != EMPTY)
+                band[e * width] = coef_w(v);
+            if (j > 0 && vec_id[e - 1] != EMPTY)
+                band[bandwidth - 1 + e * width] = coef_s(v);
+        }
+    }
+
+    corr.assign(size, 0.0);
+    res.resize(dims);
+
+    return local_solver.factorize(size, bandwidth, band);
+}
+
+void Schwarz::apply(const Stencil &stencil, Vector &x, Vector &b) {
+
+    IndicesIJ loc = stencil.getNumElts();
+    int size = elts.i * elts.j;
+
+    stencil.calculateResidual(x, b, res);
+    res.exchangeRealHalo();
+
+#pragma omp parallel for
+    for(int e = 0; e < size; ++e) {
+        corr[e] = (vec_id[e] != EMPTY) ? res(vec_id[e]) : 0.0;
+    }
+
+    local_solver.solve(corr.data());
+
+    /* Restricted: the correction of the overlap is owned by the neighbors. */
+#pragma omp parallel for
+    for(int i = 0; i < loc.i; ++i) {
+        for(int j = 0; j < loc.j; ++j) {
+            x(stencil.getID(i, j)) += corr[getExtID(i, j)];
+        }
+    }
+}
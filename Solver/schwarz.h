@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file schwarz.h
+ * @brief Contains declaration of the \e Schwarz class.
+ */
+
+#ifndef SCHWARZ_H_
+#define SCHWARZ_H_
+
+#include <vector>
+#include "../DataTypes/vector.h"
+#include "../DataTypes/stencil.h"
+#include "../General/dimensions.h"
+#include "../General/structs.h"
+#include "banded_cholesky.h"
+
+using namespace std;
+
+/*!
+ * @class Schwarz
+ * @brief Restricted additive Schwarz (RAS) preconditioner with the overlap of
+ *        one cell.
+ *
+ * Every sub-domain is extended by the layer of its halo cells. The rows of the
+ * matrix for the halo cells are taken from the neighbors, so the extended
+ * sub-domain problem has zero Dirichlet conditions on its outer boundary
+ * (including the corners, which are not part of the halo). One application
+ * solves the extended problem for the current residual and keeps the
+ * correction of the real cells only:
+ * \f[ x = x + \sum_p R_p^T \tilde{A}_p^{-1} R^{ext}_p (b - A x) \f]
+ *
+ * The extended grid has one more layer of cells on each side of the local
+ * grid, its cells are enumerated as the local ones: j + i * (nj + 2). The
+ * extended problem is solved directly with the banded Cholesky factorization,
+ * computed once in setup().
+ */
+class Schwarz {
+    IndicesIJ elts;                 // Number of cells of the extended grid in each direction
+    vector<int> vec_id;             // Vector ID of every extended cell, EMPTY if inactive
+    BandedCholesky local_solver;    // Factors of the extended problem
+    vector<double> corr;            // Right hand side of the extended problem, replaced
+                                    // with the correction
+    Vector res;                     // Residual, including the halo elements
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    Schwarz() : elts(0, 0) { }
+
+    /*!
+     * @brief Build the extended sub-domain problem.
+     * @note This is a collective call.
+     * @param stencil [in] Stencil of the local matrix
+     * @param dims [in] Dimensions of the problem
+     * @return EXIT_FAILURE if the extended problem can't be factorized,
+     *         EXIT_SUCCESS otherwise.
+     */
+    int setup(const Stencil &stencil, const Dimensions &dims);
+
+    /*!
+     * @brief Apply one step of the preconditioned Richardson iteration
+     *        \f[ x = x + M^{-1} (b - A x) \f].
+     * @note Halo elements of \e x should be up to date, they are outdated on exit.
+     * @note This is a collective call.
+     * @param stencil [in] Stencil of the local matrix
+     * @param x [in/out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     */
+    void apply(const Stencil &stencil, Vector &x, Vector &b);
+
+private:
+    /*!
+     * @brief Return ID of the extended cell from indices of the local grid.
+     */
+    inline int getExtID(int i, int j) const { return (j + 1) + (i + 1) * elts.j; }
+};
+
+#endif /* SCHWARZ_H_ */
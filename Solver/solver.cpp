@@ -25,7 +25,20 @@
  * @brief Contains definitions of methods from the \e Solver class.
  */
 
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "solver.h"
+#include "relaxation.h"
+#include "convergence.h"
+#include "../DataTypes/async_halo.h"
+
+/* Number of local sweeps between two convergence checks of asynchronous iterations */
+#define ASYNC_CHECK_INTERVAL 10
+
+/* Halos are sent in full precision once the residual is within this factor of the tolerance */
+#define HALO_PRECISION_SWITCH 100.
 
 void Solver::copyVector(Vector &vec_in, Vector &vec_out) {
 
@@ -63,12 +76,58 @@ double Solver::calculateNorm(Vector &vec) {
     return 0.0;
 }
 
-void Solver::solveJacobi(Matrix &A, Vector &x, Vector &b) {
+void Solver::solve(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    /* Asynchronous iterations have no well-defined iterates to accelerate. */
+    if (settings.type == SOLVER_ASYNC) {
+        solveAsync(A, x, b, T);
+        return;
+    }
+
+    if (settings.anderson_depth > 0) {
+        if (settings.num_blocks > 1 || settings.halo_depth > 1 || settings.balance_interval > 0
+            || settings.adaptive_omega)
+            printByRoot("Anderson acceleration wraps the plain iteration of the solver. The blocks "
+                        "(-o), the deep halo (-k), the load balancing (-b) and the tuning of the "
+                        "relaxation factor (-w auto) are not used.");
+        solveAnderson(A, x, b, T);
+        return;
+    }
+
+    switch (settings.type) {
+        case SOLVER_LINE_JACOBI:
+            solveLineJacobi(A, x, b, T);
+            break;
+
+        case SOLVER_SOR:
+            solveSOR(A, x, b, T);
+            break;
+
+        case SOLVER_SCHWARZ:
+            solveSchwarz(A, x, b, T);
+            break;
+
+        case SOLVER_DIRECT:
+            solveDirect(A, x, b, T);
+            break;
+
+        case SOLVER_JACOBI: default:
+            if (settings.num_blocks > 1)
+                solveBlockJacobi(A, x, b, T);
+            else if (settings.halo_depth > 1)
+                solveDeepJacobi(A, x, b, T);
+            else
+                solveJacobi(A, x, b, T);
+            break;
+    }
+}
+
+void Solver::solveJacobi(Matrix &A, Vector &x, Vector &b, Field &T) {
 
     int iter = 0;                   // Iteration counter
-    int max_iter = 10000;           // Maximum number of iterations
-    double tolerance = 1e-6;        // Stopping criteria
-    double omega = 2./3.;            // Under-relaxation factor
+    int max_iter = settings.max_iter;       // Maximum number of iterations
+    double tolerance = settings.tolerance;  // Stopping criteria
+    double omega = 2./3.;           // Under-relaxation factor
     double residual_norm = 0.0;     // Normalized residual
     Vector x_old;                   // Old solution
     Vector res;                     // Residual vector
@@ -76,11 +135,20 @@ void Solver::solveJacobi(Matrix &A, Vector &x, Vector &b) {
 
     my_rank = getMyRank();
 
+    if (settings.omega > 0.0)
+        omega = settings.omega;
+    Relaxation relaxation(omega);   // Tuner of the relaxation factor
+
     x_old.resize(x.getDimensions());
     res.resize(x.getDimensions());
 
     residual_norm = 10. * tolerance;
 
+    if (settings.adaptive_omega) {
+        stencil.assemble(A, T);
+        relaxation.setSpectrumBound(findSpectrumBound(stencil));
+    }
+
     copyVector(x, x_old);
 
     /* Start the main loop */
@@ -117,9 +185,977 @@ void Solver::solveJacobi(Matrix &A, Vector &x, Vector &b) {
         calculateResidual(A, x, b, res);
         residual_norm = calculateNorm(res) / calculateNorm(b);
 
+        if (my_rank == 0)
+            cout << iter << '\t' << residual_norm << endl;
+
+        if (settings.adaptive_omega && relaxation.updateJacobi(residual_norm)) {
+            omega = relaxation.getOmega();
+            printByRoot("Relaxation factor: " + std::to_string(omega));
+        }
+
+        ++iter;
+    }
+}
+
+void Solver::solveDeepJacobi(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Iteration counter
+    double omega = 2./3.;           // Under-relaxation factor
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector res;                     // Residual vector
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    if (settings.omega > 0.0)
+        omega = settings.omega;
+    Relaxation relaxation(omega);   // Tuner of the relaxation factor
+
+    res.resize(x.getDimensions());
+    setupIteration(A, x, T);
+
+    if (settings.adaptive_omega)
+        relaxation.setSpectrumBound(findSpectrumBound(stencil));
+
+    if (deep_halo.setup(stencil, x.getDimensions(), settings.halo_depth, b) == EXIT_FAILURE) {
+        printByRoot("Error! The halo is deeper than a sub-domain.");
+        terminateExecution();
+    }
+
+    norm_b = calculateNorm(b);
+    residual_norm = 10. * settings.tolerance;
+
+    deep_halo.load(x);
+    deep_halo.exchange();
+    while ( (iter < settings.max_iter) && (residual_norm > settings.tolerance) ) {
+
+        int num_sweeps = min(deep_halo.getDepth(), settings.max_iter - iter);
+
+        deep_halo.sweep(omega, num_sweeps);
+        deep_halo.exchange();
+        iter += num_sweeps;
+
+        /* The regular halo is a part of the exchanged one. */
+        deep_halo.store(x);
+        stencil.calculateResidual(x, b, res);
+        residual_norm = calculateNorm(res) / norm_b;
+
+        if (my_rank == 0)
+            cout << iter - 1 << '\t' << residual_norm << endl;
+
+        if (settings.adaptive_omega && relaxation.updateJacobi(residual_norm, num_sweeps)) {
+            omega = relaxation.getOmega();
+            printByRoot("Relaxation factor: " + std::to_string(omega));
+        }
+    }
+}
+
+void Solver::solveBlockJacobi(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Iteration counter
+    double omega = 2./3.;           // Under-relaxation factor
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector res;                     // Residual vector
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    if (settings.omega > 0.0)
+        omega = settings.omega;
+    Relaxation relaxation(omega);   // Tuner of the relaxation factor
+
+    res.resize(x.getDimensions());
+    setupIteration(A, x, T);
+    block_jacobi.setup(stencil, x.getDimensions(), b);
+
+    if (settings.adaptive_omega)
+        relaxation.setSpectrumBound(findSpectrumBound(stencil));
+
+    norm_b = calculateNorm(b);
+    residual_norm = 10. * settings.tolerance;
+
+    block_jacobi.load(x);
+    while ( (iter < settings.max_iter) && (residual_norm > settings.tolerance) ) {
+
+        /* The residual comes from the last sweep of the graph. */
+        int num_sweeps = std::min(settings.graph_sweeps, settings.max_iter - iter);
+        if (num_sweeps > 1)
+            block_jacobi.sweepDataflow(num_sweeps, omega, res);
+        else
+            block_jacobi.sweep(omega, res);
+        iter += num_sweeps - 1;
+        residual_norm = findResidualNorm(res, norm_b, residual_norm);
+
+        if (my_rank == 0)
+            cout << iter << '\t' << residual_norm << endl;
+
+        if (settings.adaptive_omega && relaxation.updateJacobi(residual_norm, num_sweeps)) {
+            omega = relaxation.getOmega();
+            printByRoot("Relaxation factor: " + std::to_string(omega));
+        }
+
+        ++iter;
+    }
+    reduction.wait();
+    block_jacobi.store(x);
+}
+
+void Solver::solveLineJacobi(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Iteration counter
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector res;                     // Residual vector
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    res.resize(x.getDimensions());
+
+    /* The matrix doesn't change, so the lines are factorized only once. */
+    setupIteration(A, x, T);
+
+    norm_b = calculateNorm(b);
+    residual_norm = 10. * settings.tolerance;
+
+    setHaloPrecision(settings.halo_precision, x);
+    x.exchangeRealHalo();
+    while ( (iter < settings.max_iter) && (residual_norm > settings.tolerance) ) {
+
+        iterate(1., x, b);
+
+        load_balancer.startTimer();
+        stencil.calculateResidual(x, b, res);
+        load_balancer.stopTimer();
+        residual_norm = findResidualNorm(res, norm_b, residual_norm);
+
+        if (my_rank == 0)
+            cout << iter << '\t' << residual_norm << endl;
+
+        if (residual_norm < HALO_PRECISION_SWITCH * settings.tolerance)
+            setHaloPrecision(PRECISION_DOUBLE, x);
+
+        balanceLoad(iter, A, x, b, T, res);
+
+        ++iter;
+    }
+    reduction.wait();
+}
+
+void Solver::solveSOR(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Iteration counter
+    double omega = 1.;              // Over-relaxation factor
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector res;                     // Residual vector
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    if (settings.omega > 0.0)
+        omega = settings.omega;
+    Relaxation relaxation(omega);   // Tuner of the relaxation factor
+
+    res.resize(x.getDimensions());
+    setupIteration(A, x, T);
+
+    norm_b = calculateNorm(b);
+    residual_norm = 10. * settings.tolerance;
+
+    setHaloPrecision(settings.halo_precision, x);
+    x.exchangeRealHalo();
+    while ( (iter < settings.max_iter) && (residual_norm > settings.tolerance) ) {
+
+        iterate(omega, x, b);
+
+        load_balancer.startTimer();
+        stencil.calculateResidual(x, b, res);
+        load_balancer.stopTimer();
+        residual_norm = findResidualNorm(res, norm_b, residual_norm);
+
+        if (my_rank == 0)
+            cout << iter << '\t' << residual_norm << endl;
+
+        if (residual_norm < HALO_PRECISION_SWITCH * settings.tolerance)
+            setHaloPrecision(PRECISION_DOUBLE, x);
+
+        balanceLoad(iter, A, x, b, T, res);
+
+        if (settings.adaptive_omega && relaxation.updateSOR(residual_norm)) {
+            omega = relaxation.getOmega();
+            printByRoot("Relaxation factor: " + std::to_string(omega));
+        }
+
+        ++iter;
+    }
+    reduction.wait();
+}
+
+void Solver::solveSchwarz(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Iteration counter
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector res;                     // Residual vector
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    res.resize(x.getDimensions());
+    setupIteration(A, x, T);
+
+    norm_b = calculateNorm(b);
+    residual_norm = 10. * settings.tolerance;
+
+    setHaloPrecision(settings.halo_precision, x);
+    x.exchangeRealHalo();
+    while ( (iter < settings.max_iter) && (residual_norm > settings.tolerance) ) {
+
+        iterate(1., x, b);
+
+        load_balancer.startTimer();
+        stencil.calculateResidual(x, b, res);
+        load_balancer.stopTimer();
+        residual_norm = findResidualNorm(res, norm_b, residual_norm);
+
+        if (my_rank == 0)
+            cout << iter << '\t' << residual_norm << endl;
+
+        if (residual_norm < HALO_PRECISION_SWITCH * settings.tolerance)
+            setHaloPrecision(PRECISION_DOUBLE, x);
+
+        balanceLoad(iter, A, x, b, T, res);
+
+        ++iter;
+    }
+    reduction.wait();
+}
+
+void Solver::solveDirect(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    double residual_norm = 0.0;     // Normalized residual
+    Vector res;                     // Residual vector
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    if (getNumProcs() > 1) {
+        printByRoot("The direct solver runs on a single process. Using it for the "
+                    "sub-domains of the Schwarz method instead.");
+        solveSchwarz(A, x, b, T);
+        return;
+    }
+
+    res.resize(x.getDimensions());
+
+    if (!direct.isFactorized()) {
+        int size = 0;
+        int bandwidth = 0;
+
+        stencil.assemble(A, T);
+        size = stencil.size();
+        bandwidth = stencil.getNumElts().j;
+
+        /* The south neighbor is the previous cell, the west one is a line of cells away. */
+        vector<double> band(size * (bandwidth + 1), 0.0);
+        for(int n = 0; n < size; ++n) {
+            band[bandwidth + n * (bandwidth + 1)] = stencil.getCentral(n);
+            if (stencil.getIdWest(n) != EMPTY)
+                band[n * (bandwidth + 1)] = stencil.getWest(n);
+            if (stencil.getIdSouth(n) != EMPTY)
+                band[bandwidth - 1 + n * (bandwidth + 1)] = stencil.getSouth(n);
+        }
+
+        if (direct.factorize(size, bandwidth, band) == EXIT_FAILURE) {
+            printByRoot("Error! The matrix is not positive definite.");
+            terminateExecution();
+        }
+    }
+
+    for(int n = 0; n < stencil.size(); ++n) {
+        x(n) = b(n);
+    }
+    direct.solve(x.getData());
+
+    stencil.calculateResidual(x, b, res);
+    residual_norm = calculateNorm(res) / calculateNorm(b);
+
+    if (my_rank == 0)
+        cout << 0 << '\t' << residual_norm << endl;
+}
+
+void Solver::solveAnderson(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Iteration counter
+    int depth = 0;                  // Number of stored differences
+    int max_depth = settings.anderson_depth;
+    int col = 0;                    // Column to store the next differences into
+    bool has_previous = false;      // True if the previous iterate is available
+    int size = 0;                   // Number of local (real) elements
+    double omega = 1.;              // Relaxation factor of the underlying iteration
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector g;                       // Result of the fixed-point iteration G(x)
+    Vector res;                     // Residual vector
+    vector<double> f, f_old, g_old; // Current/previous fixed-point residuals f = G(x) - x and G(x)
+    vector<vector<double> > df, dg; // Differences of f and G(x) between iterations
+    vector<double> gram;            // Gram matrix of df (max_depth x max_depth)
+    vector<double> gamma;           // Coefficients of the extrapolation
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    if (settings.omega > 0.0)
+        omega = settings.omega;
+    else if (settings.type == SOLVER_JACOBI)
+        omega = 2./3.;
+
+    g.resize(x.getDimensions());
+    res.resize(x.getDimensions());
+    setupIteration(A, x, T);
+
+    size = stencil.size();
+    f.resize(size);
+    f_old.resize(size);
+    g_old.resize(size);
+    df.assign(max_depth, vector<double>(size));
+    dg.assign(max_depth, vector<double>(size));
+    gram.assign(max_depth * max_depth, 0.0);
+    gamma.resize(max_depth);
+
+    norm_b = calculateNorm(b);
+    residual_norm = 10. * settings.tolerance;
+
+    x.exchangeRealHalo();
+    while ( (iter < settings.max_iter) && (residual_norm > settings.tolerance) ) {
+
+        /* Apply the fixed-point iteration g = G(x) */
+        for(int n = 0; n < g.numRows(); ++n) {
+            g(n) = x(n);
+        }
+        iterate(omega, g, b);
+
+#pragma omp parallel for
+        for(int n = 0; n < size; ++n) {
+            f[n] = g(n) - x(n);
+        }
+
+        /*
+         * Store the newest differences. The columns are used as a ring
+         * buffer, the Gram matrix is updated for the new column only.
+         */
+        if (has_previous) {
+            depth = std::min(depth + 1, max_depth);
+
+#pragma omp parallel for
+            for(int n = 0; n < size; ++n) {
+                df[col][n] = f[n] - f_old[n];
+                dg[col][n] = g(n) - g_old[n];
+            }
+
+            for(int k = 0; k < depth; ++k) {
+                double dot = dotProduct(df[col], df[k]);
+                gram[col + k * max_depth] = dot;
+                gram[k + col * max_depth] = dot;
+            }
+            col = (col + 1) % max_depth;
+        }
+
+        has_previous = true;
+        f_old = f;
+        for(int n = 0; n < size; ++n) {
+            g_old[n] = g(n);
+        }
+
+        /* Extrapolate: x = g - dg * gamma, where gamma minimizes |f - df * gamma| */
+        for(int n = 0; n < size; ++n) {
+            x(n) = g(n);
+        }
+        if (depth > 0) {
+            for(int k = 0; k < depth; ++k) {
+                gamma[k] = dotProduct(df[k], f);
+            }
+
+            if (solveLeastSquares(depth, max_depth, gram, gamma) == EXIT_SUCCESS) {
+                for(int k = 0; k < depth; ++k) {
+#pragma omp parallel for
+                    for(int n = 0; n < size; ++n) {
+                        x(n) -= gamma[k] * dg[k][n];
+                    }
+                }
+            }
+            else {
+                /* The differences became linearly dependent, restart. */
+                depth = 0;
+                col = 0;
+            }
+        }
+        x.exchangeRealHalo();
+
+        stencil.calculateResidual(x, b, res);
+        residual_norm = calculateNorm(res) / norm_b;
+
         if (my_rank == 0)
             cout << iter << '\t' << residual_norm << endl;
 
         ++iter;
     }
 }
+
+void Solver::solveAsync(Matrix &A, Vector &x, Vector &b, Field &T) {
+
+    int iter = 0;                   // Number of sweeps done by the slowest thread
+    int stop = 0;                   // Set by the master thread once all processes agree to stop
+    bool exhausted = false;         // True if any process reached the iteration limit
+    double omega = 1.;              // Relaxation factor
+    double residual_norm = 0.0;     // Normalized residual
+    double norm_b = 0.0;            // L2-norm of the right hand side
+    Vector res;                     // Residual vector
+    AsyncHalo halo(x);              // Asynchronous exchange of the halo elements
+    ConvergenceDetector detector;   // Distributed convergence detection
+    vector<int> num_sweeps;         // Number of sweeps done by each thread
+    int my_rank = 0;                // Process rank (0 in non-MPI case)
+
+    my_rank = getMyRank();
+
+    if (settings.omega > 0.0)
+        omega = settings.omega;
+
+    res.resize(x.getDimensions());
+    setupIteration(A, x, T);
+    norm_b = calculateNorm(b);
+#ifdef _OPENMP
+    num_sweeps.assign(omp_get_max_threads(), 0);
+#else
+    num_sweeps.assign(1, 0);
+#endif
+
+    x.exchangeRealHalo();
+    residual_norm = 10. * settings.tolerance;
+
+    /*
+     * The detected residual is summed up while the cells and the halos are
+     * still changing, so it is only a hint. Once the processes agree to stop,
+     * the residual is checked again on consistent data and the iterations go
+     * on if it is still too large.
+     */
+    while (residual_norm > settings.tolerance && !exhausted) {
+        stop = 0;
+        halo.start();
+
+        /*
+         * Every thread relaxes its own block of cells in place, as many times as
+         * it can, using whatever values its neighbors have written so far. Only
+         * the master thread communicates with other processes.
+         */
+#pragma omp parallel
+        {
+            int thread = 0;
+            int num_threads = 1;
+            int done = 0;
+#ifdef _OPENMP
+            thread = omp_get_thread_num();
+            num_threads = omp_get_num_threads();
+#endif
+            int my_sweeps = num_sweeps[thread];
+            int beg = (int)((long)stencil.size() * thread / num_threads);
+            int end = (int)((long)stencil.size() * (thread + 1) / num_threads);
+
+            while (!done) {
+                sweepAsync(stencil, beg, end, omega, x, b);
+                ++my_sweeps;
+#pragma omp atomic write
+                num_sweeps[thread] = my_sweeps;
+
+                if (thread == 0) {
+                    double residual_sqr = 0.0;
+
+                    /* Threads may run at different pace, the slowest one counts. */
+                    iter = my_sweeps;
+                    for(int t = 1; t < num_threads; ++t) {
+                        int sweeps;
+#pragma omp atomic read
+                        sweeps = num_sweeps[t];
+                        iter = std::min(iter, sweeps);
+                    }
+                    halo.progress();
+
+                    if (detector.test(residual_sqr, exhausted)) {
+                        residual_norm = sqrt(residual_sqr) / norm_b;
+                        if (my_rank == 0)
+                            cout << iter << '\t' << residual_norm << endl;
+                        if (residual_norm <= settings.tolerance || exhausted) {
+#pragma omp atomic write
+                            stop = 1;
+                        }
+                    }
+                    else if (!detector.isActive() && my_sweeps % ASYNC_CHECK_INTERVAL == 0) {
+                        detector.start(calculateLocalResidualShared(stencil, x, b),
+                                       iter >= settings.max_iter);
+                    }
+                }
+
+#pragma omp atomic read
+                done = stop;
+            }
+        }
+
+        halo.finish();
+        x.exchangeRealHalo();
+
+        stencil.calculateResidual(x, b, res);
+        residual_norm = calculateNorm(res) / norm_b;
+    }
+
+    if (my_rank == 0)
+        cout << "Final residual: " << residual_norm << endl;
+}
+
+void Solver::setupIteration(Matrix &A, Vector &x, Field &T) {
+
+    IndicesIJ beg_ind_glob = x.getDimensions().getBegIndicesGlob();
+
+    stencil.assemble(A, T);
+    work.resize(stencil.size());
+    load_balancer.setInterval(settings.balance_interval);
+    if (settings.reduction != REDUCTION_BLOCKING)
+        reduction.setup(settings.reduction == REDUCTION_NODE);
+    x_new.resize(x.getDimensions());
+
+    /* Cells are colored by the global indices, so the ordering doesn't depend on the decomposition. */
+    parity = (beg_ind_glob.i + beg_ind_glob.j) % 2;
+
+    if (settings.type == SOLVER_LINE_JACOBI) {
+        factorizeLines(stencil, x.getDimensions(), true, lines_i);
+        factorizeLines(stencil, x.getDimensions(), false, lines_j);
+    }
+    else if (settings.type == SOLVER_SCHWARZ || settings.type == SOLVER_DIRECT) {
+        if (schwarz.setup(stencil, x.getDimensions()) == EXIT_FAILURE) {
+            printByRoot("Error! The sub-domain matrix is not positive definite.");
+            terminateExecution();
+        }
+    }
+}
+
+double Solver::findResidualNorm(Vector &res, double norm_b, double residual_norm) {
+
+    double sum = 0.0;               // Local part of the squared norm
+    bool lagged = false;            // True if the previous reduction is in flight
+#ifdef _OPENMP
+    int chunk = stencil.getNumElts().j;     // Cells handed out to a thread at once
+#endif
+
+    if (settings.reduction == REDUCTION_BLOCKING)
+        return calculateNorm(res) / norm_b;
+
+    lagged = reduction.isActive();
+
+#pragma omp parallel reduction(+:sum)
+    {
+        /* A dedicated thread completes the previous reduction while the others sum up. */
+        if (settings.comm_thread == COMM_DEDICATED) {
+#pragma omp master
+            reduction.wait();
+        }
+
+#pragma omp for schedule(dynamic, chunk) nowait
+        for(int n = 0; n < res.getLocElts(); ++n) {
+            sum += res(n) * res(n);
+        }
+    }
+
+    if (lagged) {
+        reduction.wait();
+        residual_norm = sqrt(reduction.getResult(0)) / norm_b;
+    }
+    reduction.start(&sum, 1, REDUCE_SUM);
+
+    /* Without MPI the reduction completes at once, so the norm doesn't lag. */
+    if (!reduction.isActive())
+        residual_norm = sqrt(reduction.getResult(0)) / norm_b;
+
+    return residual_norm;
+}
+
+void Solver::balanceLoad(int iter, Matrix &A, Vector &x, Vector &b, Field &T, Vector &res) {
+
+    Dimensions new_dims;
+    Vector coefs[5];                // Central, west, east, south and north coefficients
+
+    if (!load_balancer.check(iter, x.getDimensions(), new_dims))
+        return;
+
+    /* The coefficients travel with the cells, the missing neighbors are zero. */
+    for(int k = 0; k < 5; ++k)
+        coefs[k].resize(x.getDimensions());
+    for(int n = 0; n < stencil.size(); ++n) {
+        coefs[0](n) = stencil.getCentral(n);
+        coefs[1](n) = (stencil.getIdWest(n) != EMPTY) ? stencil.getWest(n) : 0.0;
+        coefs[2](n) = (stencil.getIdEast(n) != EMPTY) ? stencil.getEast(n) : 0.0;
+        coefs[3](n) = (stencil.getIdSouth(n) != EMPTY) ? stencil.getSouth(n) : 0.0;
+        coefs[4](n) = (stencil.getIdNorth(n) != EMPTY) ? stencil.getNorth(n) : 0.0;
+    }
+
+    LoadBalancer::migrate(new_dims, x);
+    LoadBalancer::migrate(new_dims, b);
+    for(int k = 0; k < 5; ++k)
+        LoadBalancer::migrate(new_dims, coefs[k]);
+
+    T.resize(new_dims);
+    A.resize(new_dims);
+    std::fill(A.getData(), A.getData() + A.size(), 0.0);
+
+    /* Rebuild the matrix the way it is read by Stencil::assemble(). */
+    IndicesBegEnd int_ind_i = new_dims.getInternalIndRangeI();
+    IndicesBegEnd int_ind_j = new_dims.getInternalIndRangeJ();
+    IndicesIJ num_elts = new_dims.getNumElts();
+
+    for(int i = int_ind_i.beg; i <= int_ind_i.end; ++i) {
+        for(int j = int_ind_j.beg; j <= int_ind_j.end; ++j) {
+
+            int row = T.getID(i, j);
+
+            A(row, row) = coefs[0](row);
+            if (i > 0)
+                A(row, T.getID(i - 1, j)) = coefs[1](row);
+            if (i < num_elts.i - 1)
+                A(row, T.getID(i + 1, j)) = coefs[2](row);
+            if (j > 0)
+                A(row, T.getID(i, j - 1)) = coefs[3](row);
+            if (j < num_elts.j - 1)
+                A(row, T.getID(i, j + 1)) = coefs[4](row);
+        }
+    }
+
+    res.resize(new_dims);
+    setupIteration(A, x, T);
+    x.exchangeRealHalo();
+}
+
+void Solver::iterate(double omega, Vector &x, Vector &b) {
+
+    switch (settings.type) {
+        case SOLVER_LINE_JACOBI:
+            /* Implicit along j-lines, explicit in i-th direction */
+            sweepLines(stencil, false, lines_j, x, b, work);
+            x.exchangeRealHalo();
+
+            /* Implicit along i-lines, explicit in j-th direction */
+            sweepLines(stencil, true, lines_i, x, b, work);
+            x.exchangeRealHalo();
+            break;
+
+        case SOLVER_SCHWARZ: case SOLVER_DIRECT:
+            schwarz.apply(stencil, x, b);
+            x.exchangeRealHalo();
+            break;
+
+        case SOLVER_SOR:
+            for(int color = 0; color < 2; ++color) {
+                sweepRedBlack(stencil, (color + parity) % 2, omega, x, b);
+            }
+            break;
+
+        case SOLVER_JACOBI: default:
+            sweepJacobi(stencil, omega, x, b);
+            break;
+    }
+}
+
+void Solver::factorizeLines(const Stencil &stencil, const Dimensions &dims, bool along_i,
+                            Tridiagonal &lines) {
+
+    IndicesIJ elts = stencil.getNumElts();
+    IndicesIJ proc_ind = dims.getDecomposition().getProcIndices();
+    int size = along_i ? elts.i : elts.j;           // Number of unknowns in a line
+    int num_lines = along_i ? elts.j : elts.i;      // Number of lines
+    vector<double> a(stencil.size()), d(stencil.size()), c(stencil.size());
+    vector<double> a_first(num_lines), c_last(num_lines);
+
+    /*
+     * Lines along i-th direction are shared by processes with the same j-th
+     * coordinate and vice versa.
+     */
+    if (along_i)
+        lines.createLineCommunicator(proc_ind.j, proc_ind.i);
+    else
+        lines.createLineCommunicator(proc_ind.i, proc_ind.j);
+
+    for(int i = 0; i < elts.i; ++i) {
+        for(int j = 0; j < elts.j; ++j) {
+            int id = stencil.getID(i, j);
+            int k = along_i ? i : j;
+            int l = along_i ? j : i;
+            int pos = l + k * num_lines;
+
+            d[pos] = stencil.getCentral(id);
+            a[pos] = along_i ? stencil.getWest(id) : stencil.getSouth(id);
+            c[pos] = along_i ? stencil.getEast(id) : stencil.getNorth(id);
+
+            if (k == 0)
+                a_first[l] = a[pos];
+            if (k == size - 1)
+                c_last[l] = c[pos];
+        }
+    }
+
+    lines.factorize(size, num_lines, a.data(), d.data(), c.data(), a_first.data(), c_last.data());
+}
+
+void Solver::sweepLines(const Stencil &stencil, bool along_i, Tridiagonal &lines,
+                        Vector &x, Vector &b, vector<double> &rhs) {
+
+    IndicesIJ elts = stencil.getNumElts();
+    int num_lines = along_i ? elts.j : elts.i;
+    const double *x_data = x.getData();
+
+    /* Move the contribution of the other direction to the right hand side */
+#pragma omp parallel for
+    for(int i = 0; i < elts.i; ++i) {
+        for(int j = 0; j < elts.j; ++j) {
+            int id = stencil.getID(i, j);
+            int pos = along_i ? id : i + j * num_lines;
+            double value = b(id);
+
+            if (along_i) {
+                if (stencil.getIdSouth(id) != EMPTY)
+                    value -= stencil.getSouth(id) * x_data[stencil.getIdSouth(id)];
+                if (stencil.getIdNorth(id) != EMPTY)
+                    value -= stencil.getNorth(id) * x_data[stencil.getIdNorth(id)];
+            }
+            else {
+                if (stencil.getIdWest(id) != EMPTY)
+                    value -= stencil.getWest(id) * x_data[stencil.getIdWest(id)];
+                if (stencil.getIdEast(id) != EMPTY)
+                    value -= stencil.getEast(id) * x_data[stencil.getIdEast(id)];
+            }
+            rhs[pos] = value;
+        }
+    }
+
+    lines.solve(rhs.data());
+
+#pragma omp parallel for
+    for(int i = 0; i < elts.i; ++i) {
+        for(int j = 0; j < elts.j; ++j) {
+            int id = stencil.getID(i, j);
+            x(id) = rhs[along_i ? id : i + j * num_lines];
+        }
+    }
+}
+
+void Solver::sweepRedBlack(const Stencil &stencil, int color, double omega, Vector &x, Vector &b) {
+
+    IndicesIJ elts = stencil.getNumElts();
+    double *x_data = x.getData();
+    const vector<int> &boundary = stencil.getBoundaryCells();
+
+    /*
+     * Cells of the same color are not connected, so they are updated in
+     * parallel. Cells of the other color don't change, hence the halo
+     * exchange can start as soon as the boundary cells are updated.
+     */
+#pragma omp parallel for
+    for(int k = 0; k < (int)boundary.size(); ++k) {
+        int id = boundary[k];
+        if ((id / elts.j + id % elts.j) % 2 == color) {
+            double x_gs = (b(id) - stencil.offDiagonal(x_data, id)) / stencil.getCentral(id);
+            x_data[id] += omega * (x_gs - x_data[id]);
+        }
+    }
+
+#pragma omp parallel
+    {
+        exchangeWhileComputing(x);
+
+#pragma omp for schedule(dynamic) nowait
+        for(int i = 0; i < elts.i; ++i) {
+            for(int j = (i + color) % 2; j < elts.j; j += 2) {
+                int id = stencil.getID(i, j);
+                if (stencil.isOnBoundary(id))
+                    continue;
+                double x_gs = (b(id) - stencil.offDiagonal(x_data, id)) / stencil.getCentral(id);
+                x_data[id] += omega * (x_gs - x_data[id]);
+            }
+        }
+    }
+
+    if (settings.comm_thread == COMM_MASTER)
+        x.finishHaloExchange();
+}
+
+void Solver::sweepJacobi(const Stencil &stencil, double omega, Vector &x, Vector &b) {
+
+    const double *x_data = x.getData();
+    const vector<int> &boundary = stencil.getBoundaryCells();
+    int size = stencil.size();
+#ifdef _OPENMP
+    int chunk = stencil.getNumElts().j;     // Cells handed out to a thread at once
+#endif
+
+    /* New values of the boundary cells travel while the interior is updated. */
+#pragma omp parallel for
+    for(int k = 0; k < (int)boundary.size(); ++k) {
+        int n = boundary[k];
+        double x_jac = (b(n) - stencil.offDiagonal(x_data, n)) / stencil.getCentral(n);
+        x_new(n) = x_data[n] + omega * (x_jac - x_data[n]);
+    }
+
+#pragma omp parallel
+    {
+        exchangeWhileComputing(x_new);
+
+#pragma omp for schedule(dynamic, chunk) nowait
+        for(int n = 0; n < size; ++n) {
+            if (stencil.isOnBoundary(n))
+                continue;
+            double x_jac = (b(n) - stencil.offDiagonal(x_data, n)) / stencil.getCentral(n);
+            x_new(n) = x_data[n] + omega * (x_jac - x_data[n]);
+        }
+    }
+
+    if (settings.comm_thread == COMM_MASTER)
+        x_new.finishHaloExchange();
+    x.swapData(x_new);
+}
+
+void Solver::sweepAsync(const Stencil &stencil, int beg, int end, double omega, Vector &x,
+                        Vector &b) {
+
+    double *x_data = x.getData();
+
+    for(int n = beg; n < end; ++n) {
+        double x_old, x_new;
+#pragma omp atomic read
+        x_old = x_data[n];
+        x_new = (b(n) - stencil.offDiagonalShared(x_data, n)) / stencil.getCentral(n);
+        x_new = x_old + omega * (x_new - x_old);
+#pragma omp atomic write
+        x_data[n] = x_new;
+    }
+}
+
+void Solver::exchangeWhileComputing(Vector &vec) {
+
+    /*
+     * The master thread is the only one that communicates. Either it starts the
+     * exchange and joins the others, or it completes the exchange first and
+     * picks up the cells they have left.
+     */
+#pragma omp master
+    {
+        vec.startHaloExchange();
+        if (settings.comm_thread == COMM_DEDICATED)
+            vec.finishHaloExchange();
+    }
+}
+
+double Solver::calculateLocalResidualShared(const Stencil &stencil, Vector &x, Vector &b) {
+
+    const double *x_data = x.getData();
+    double residual_sqr = 0.0;
+
+    for(int n = 0; n < stencil.size(); ++n) {
+        double value, x_n;
+#pragma omp atomic read
+        x_n = x_data[n];
+        value = b(n) - stencil.getCentral(n) * x_n - stencil.offDiagonalShared(x_data, n);
+        residual_sqr += value * value;
+    }
+
+    return residual_sqr;
+}
+
+double Solver::dotProduct(const vector<double> &vec_a, const vector<double> &vec_b) {
+
+    double dot = 0.0;
+
+#pragma omp parallel for reduction(+:dot)
+    for(int n = 0; n < (int)vec_a.size(); ++n) {
+        dot += vec_a[n] * vec_b[n];
+    }
+    findGlobalSum(dot);
+
+    return dot;
+}
+
+int Solver::solveLeastSquares(int depth, int max_depth, const vector<double> &gram,
+                              vector<double> &rhs) {
+
+    vector<double> mat(depth * depth);
+    double scale = 0.0;
+
+    /*
+     * Solve the normal equations with Gaussian elimination. The system is
+     * tiny, a small Tikhonov regularization keeps it solvable when the
+     * differences are nearly dependent.
+     */
+    for(int r = 0; r < depth; ++r) {
+        for(int c = 0; c < depth; ++c) {
+            mat[c + r * depth] = gram[c + r * max_depth];
+        }
+        scale = std::max(scale, gram[r + r * max_depth]);
+    }
+    if (scale <= 0.0)
+        return EXIT_FAILURE;
+    for(int r = 0; r < depth; ++r) {
+        mat[r + r * depth] += 1e-12 * scale;
+    }
+
+    for(int k = 0; k < depth; ++k) {
+        int pivot = k;
+        for(int r = k + 1; r < depth; ++r) {
+            if (fabs(mat[k + r * depth]) > fabs(mat[k + pivot * depth]))
+                pivot = r;
+        }
+        if (fabs(mat[k + pivot * depth]) < 1e-14 * scale)
+            return EXIT_FAILURE;
+        if (pivot != k) {
+            for(int c = 0; c < depth; ++c) {
+                std::swap(mat[c + k * depth], mat[c + pivot * depth]);
+            }
+            std::swap(rhs[k], rhs[pivot]);
+        }
+        for(int r = k + 1; r < depth; ++r) {
+            double factor = mat[k + r * depth] / mat[k + k * depth];
+            for(int c = k; c < depth; ++c) {
+                mat[c + r * depth] -= factor * mat[c + k * depth];
+            }
+            rhs[r] -= factor * rhs[k];
+        }
+    }
+
+    for(int k = depth - 1; k >= 0; --k) {
+        for(int c = k + 1; c < depth; ++c) {
+            rhs[k] -= mat[c + k * depth] * rhs[c];
+        }
+        rhs[k] /= mat[k + k * depth];
+    }
+
+    return EXIT_SUCCESS;
+}
+
+double Solver::findSpectrumBound(const Stencil &stencil) {
+
+    double bound = 0.0;
+
+    /* Gershgorin bound of the spectrum of D^-1 A, the couplings to the boundary are none */
+    for(int n = 0; n < stencil.size(); ++n) {
+        double sum = 0.0;
+        if (stencil.getIdWest(n) != EMPTY)
+            sum += fabs(stencil.getWest(n));
+        if (stencil.getIdEast(n) != EMPTY)
+            sum += fabs(stencil.getEast(n));
+        if (stencil.getIdSouth(n) != EMPTY)
+            sum += fabs(stencil.getSouth(n));
+        if (stencil.getIdNorth(n) != EMPTY)
+            sum += fabs(stencil.getNorth(n));
+        bound = std::max(bound, 1. + sum / fabs(stencil.getCentral(n)));
+    }
+    findGlobalMax(bound);
+
+    return bound;
+}
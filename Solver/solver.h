@@ -39,7 +39,16 @@
 
 #include "../DataTypes/matrix.h"
 #include "../DataTypes/vector.h"
+#include "../DataTypes/field.h"
+#include "../DataTypes/stencil.h"
 #include "../General/structs.h"
+#include "../MPI/reduction.h"
+#include "tridiagonal.h"
+#include "schwarz.h"
+#include "banded_cholesky.h"
+#include "deep_halo.h"
+#include "block_jacobi.h"
+#include "load_balancer.h"
 
 using namespace std;
 
@@ -48,7 +57,47 @@ using namespace std;
  * @brief Responsible for all math operations.
  */
 class Solver {
+    SolverSettings settings;    // Type of the solver and its parameters
+    Stencil stencil;            // Stencil of the local matrix
+    Tridiagonal lines_i;        // Tridiagonal systems along i-lines
+    Tridiagonal lines_j;        // Tridiagonal systems along j-lines
+    Schwarz schwarz;            // Restricted additive Schwarz preconditioner
+    BandedCholesky direct;      // Factors of the local matrix (direct solver)
+    DeepHalo deep_halo;         // Extended sub-domain of the Jacobi method with a deep halo
+    BlockJacobi block_jacobi;   // Blocks of the sub-domain of the Jacobi method
+    LoadBalancer load_balancer; // Dynamic balancing of the load between the processes
+    Reduction reduction;        // Reduction of the residual norm overlapped with the sweeps
+    vector<double> work;        // Work array of the fixed-point iterations
+    Vector x_new;               // Next iterate of the damped Jacobi method
+    int parity;                 // Color of the very first local cell (red-black ordering)
+
+    friend class Utests;
+
 public:
+    /*!
+     * @brief Default constructor.
+     */
+    Solver() : parity(0) { }
+
+    /*!
+     * @brief Set the type of the solver and its parameters.
+     * @param in_settings [in] Solver settings
+     */
+    inline void setSettings(const SolverSettings &in_settings) { settings = in_settings; }
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] with the solver
+     *        chosen in the settings.
+     * If the depth of Anderson acceleration is set, the iteration of the chosen
+     * solver is wrapped by \e solveAnderson().
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solve(Matrix &A, Vector &x, Vector &b, Field &T);
+
     /*!
      * @brief Calculate the residual \f[ r = b - Ax \f].
      * @param A [in] Matrix
@@ -78,8 +127,304 @@ public:
      * @param A [in] Matrix
      * @param x [out] Vector of unknowns
      * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveJacobi(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] using damped
+     *        Jacobi method with a halo of several layers.
+     * The halo is exchanged once per as many iterations as its depth, the
+     * halo cells are updated redundantly in between, see \e DeepHalo. The
+     * residual is checked after every exchange, so the number of iterations
+     * is rounded up to a multiple of the depth.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveDeepJacobi(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] using damped
+     *        Jacobi method on a sub-domain split into several blocks.
+     * Blocks are updated by OpenMP tasks as soon as their halo is complete,
+     * see \e BlockJacobi. The residual comes with the sweep, so the reported
+     * one is of the iterate before the sweep.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveBlockJacobi(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] using alternating
+     *        direction line Jacobi method.
+     * Every iteration first solves tridiagonal systems along all j-lines of the
+     * field, treating the i-th direction explicitly, and then along all i-lines.
+     * Lines split between several processes are solved with the partitioned
+     * algorithm, see \e Tridiagonal.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveLineJacobi(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] using red-black
+     *        successive over-relaxation (SOR).
+     * With the relaxation factor equal to 1 this is the Gauss-Seidel method.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveSOR(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] by Richardson
+     *        iteration preconditioned with restricted additive Schwarz method.
+     * Every process solves its sub-domain extended by the halo cells, see
+     * \e Schwarz. Combine with Anderson acceleration for a faster convergence.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveSchwarz(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] with the banded
+     *        Cholesky factorization.
+     * The factors are computed on the first call and reused by the following
+     * ones, so solving for a new right hand side costs two triangular solves.
+     * Call \e releaseFactors() if the matrix changes.
+     * With several processes the system is solved by \e solveSchwarz(), which
+     * uses the same factorization for the sub-domains.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveDirect(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Release the factors kept by \e solveDirect().
+     */
+    inline void releaseFactors() { direct.clear(); }
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] by Anderson
+     *        acceleration of a fixed-point iteration.
+     * The iteration x = G(x) is one step of the solver chosen in the settings.
+     * Every new iterate is extrapolated from the last m iterates as
+     * \f[ x = G(x_k) - \sum_i \gamma_i \Delta G_i \f], where gamma minimizes
+     * the norm of the combined fixed-point residual G(x) - x.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveAnderson(Matrix &A, Vector &x, Vector &b, Field &T);
+
+    /*!
+     * @brief Solve the provided linear system \f[ A x = b \f] by asynchronous
+     *        (chaotic) relaxation.
+     * Threads relax their blocks in place without waiting for each other and
+     * processes exchange the halo elements without waiting for the neighbors,
+     * see \e AsyncHalo. Iterations are paused when all processes agree on
+     * convergence, see \e ConvergenceDetector. The residual is then checked
+     * again after the halos are exchanged, and the iterations resume if it is
+     * still above the tolerance.
+     * @note Memory for the vectors and matrix should be pre-allocated.
+     * @param A [in] Matrix
+     * @param x [out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void solveAsync(Matrix &A, Vector &x, Vector &b, Field &T);
+
+private:
+    /*!
+     * @brief Prepare the fixed-point iteration of the solver chosen in the
+     *        settings.
+     * @note This is a collective call.
+     * @param A [in] Matrix
+     * @param x [in] Vector of unknowns, provides the layout of the data
+     * @param T [in] Field, provides the grid structure of the system
+     */
+    void setupIteration(Matrix &A, Vector &x, Field &T);
+
+    /*!
+     * @brief Check the balance of the load and move the cut lines if it is
+     *        needed, see \e LoadBalancer.
+     * The real elements of the vectors and the coefficients of the matrix are
+     * moved to the new sub-domains, then the field, the matrix and the
+     * iteration are set up again. The halo elements of \e x are up to date
+     * on exit.
+     * @note This is a collective call.
+     * @param iter [in] Number of the iteration
+     * @param A [in/out] Matrix
+     * @param x [in/out] Vector of unknowns
+     * @param b [in/out] Vector of right hand side
+     * @param T [in/out] Field, provides the grid structure of the system
+     * @param res [in/out] Vector of residual
+     */
+    void balanceLoad(int iter, Matrix &A, Vector &x, Vector &b, Field &T, Vector &res);
+
+    /*!
+     * @brief Find the normalized norm of the residual with the reduction
+     *        chosen in the settings.
+     * An overlapped reduction of the residual is started and the norm of the
+     * previous residual is returned, so the reduction runs during the next
+     * sweep and the norm lags one iteration behind. Call \e reduction.wait()
+     * after the last iteration.
+     * @note This is a collective call.
+     * @param res [in] Vector of residual
+     * @param norm_b [in] L2-norm of the right hand side
+     * @param residual_norm [in] Norm returned by the previous call
+     * @return Normalized residual
+     */
+    double findResidualNorm(Vector &res, double norm_b, double residual_norm);
+
+    /*!
+     * @brief Set the precision of the halo exchanges of the iterates.
+     * @param precision [in] One of PRECISION_* (see macro.h)
+     * @param x [in/out] Vector of unknowns
+     */
+    inline void setHaloPrecision(int precision, Vector &x) {
+        x.setHaloPrecision(precision);
+        x_new.setHaloPrecision(precision);
+    }
+
+    /*!
+     * @brief Perform one step of the fixed-point iteration of the solver
+     *        chosen in the settings.
+     * @note Halo elements of \e x should be up to date. They are updated on exit.
+     * @param omega [in] Relaxation factor (ignored by the line Jacobi and Schwarz methods)
+     * @param x [in/out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     */
+    void iterate(double omega, Vector &x, Vector &b);
+
+    /*!
+     * @brief Perform one step of the damped Jacobi method.
+     * The boundary cells are updated first, so their exchange overlaps with
+     * the update of the interior cells.
+     * @note Halo elements of \e x should be up to date. They are updated on exit.
+     * @param stencil [in] Stencil of the local matrix
+     * @param omega [in] Relaxation factor
+     * @param x [in/out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     */
+    void sweepJacobi(const Stencil &stencil, double omega, Vector &x, Vector &b);
+
+    /*!
+     * @brief Relax a block of cells in place, the elements of \e x may be
+     *        updated by other threads concurrently.
+     * @param stencil [in] Stencil of the local matrix
+     * @param beg [in] First cell of the block
+     * @param end [in] Cell after the last one of the block
+     * @param omega [in] Relaxation factor
+     * @param x [in/out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     */
+    void sweepAsync(const Stencil &stencil, int beg, int end, double omega, Vector &x,
+                    Vector &b);
+
+    /*!
+     * @brief Exchange the halo of the vector by the master thread while the
+     *        other threads of the enclosing parallel region compute. With
+     *        COMM_DEDICATED the exchange is completed here, otherwise it is
+     *        only started and should be finished after the parallel region.
+     * @note Called by all threads of the parallel region.
+     * @param vec [in/out] Vector whose halo is exchanged
+     */
+    void exchangeWhileComputing(Vector &vec);
+
+    /*!
+     * @brief Calculate the local squared residual while the elements of \e x
+     *        may be updated by other threads concurrently.
+     * @param stencil [in] Stencil of the local matrix
+     * @param x [in] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @return Sum of squares of the local residual
+     */
+    double calculateLocalResidualShared(const Stencil &stencil, Vector &x, Vector &b);
+
+    /*!
+     * @brief Calculate the global dot product of two vectors of local elements.
+     * @param vec_a [in] First vector
+     * @param vec_b [in] Second vector
+     * @return Dot product
+     */
+    double dotProduct(const vector<double> &vec_a, const vector<double> &vec_b);
+
+    /*!
+     * @brief Solve the normal equations of the Anderson least squares problem.
+     * @param depth [in] Number of unknowns
+     * @param max_depth [in] Leading dimension of the Gram matrix
+     * @param gram [in] Gram matrix
+     * @param rhs [in/out] Right hand side, replaced with the solution
+     * @return EXIT_FAILURE if the matrix is singular, EXIT_SUCCESS otherwise.
+     */
+    int solveLeastSquares(int depth, int max_depth, const vector<double> &gram,
+                          vector<double> &rhs);
+
+    /*!
+     * @brief Perform a half-step of the red-black SOR method, i.e. update
+     *        cells of one color.
+     * The boundary cells are updated first, so their exchange overlaps with
+     * the update of the interior cells.
+     * @note Halo elements of \e x should be up to date. They are updated on exit.
+     * @param stencil [in] Stencil of the local matrix
+     * @param color [in] Color of the cells to update, relative to the first local cell
+     * @param omega [in] Relaxation factor
+     * @param x [in/out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     */
+    void sweepRedBlack(const Stencil &stencil, int color, double omega, Vector &x, Vector &b);
+
+    /*!
+     * @brief Find an upper bound of the spectrum of \f[ D^{-1} A \f].
+     * @param stencil [in] Coefficients of the matrix, per cell
+     * @return Gershgorin bound of the largest eigenvalue
+     */
+    double findSpectrumBound(const Stencil &stencil);
+
+    /*!
+     * @brief Factorize tridiagonal systems along the lines of the grid.
+     * @note This is a collective call.
+     * @param stencil [in] Stencil of the local matrix
+     * @param dims [in] Dimensions of the problem
+     * @param along_i [in] Lines go along i-th direction if true, along j-th otherwise
+     * @param lines [out] Factorized lines
+     */
+    void factorizeLines(const Stencil &stencil, const Dimensions &dims, bool along_i,
+                        Tridiagonal &lines);
+
+    /*!
+     * @brief Perform a half-step of the line Jacobi method, i.e. solve all
+     *        lines in one direction.
+     * @note Halo elements of \e x should be up to date.
+     * @param stencil [in] Stencil of the local matrix
+     * @param along_i [in] Lines go along i-th direction if true, along j-th otherwise
+     * @param lines [in] Factorized lines
+     * @param x [in/out] Vector of unknowns
+     * @param b [in] Vector of right hand side
+     * @param rhs [-] Work array
      */
-    void solveJacobi(Matrix &A, Vector &x, Vector &b);
+    void sweepLines(const Stencil &stencil, bool along_i, Tridiagonal &lines,
+                    Vector &x, Vector &b, vector<double> &rhs);
 };
 
 
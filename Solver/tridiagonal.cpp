@@ -0,0 +1,256 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file tridiagonal.cpp
+ * @brief Contains definitions of methods from the \e Tridiagonal class.
+ */
+
+#include <algorithm>
+#include "tridiagonal.h"
+
+/* Number of lines processed together by a single thread. */
+#define LINE_BLOCK 64
+
+Tridiagonal::Tridiagonal() : size(0), num_lines(0), line_rank(0), line_procs(1) {
+#ifdef USE_MPI
+    line_comm = MPI_COMM_NULL;
+#endif
+}
+
+Tridiagonal::~Tridiagonal() {
+#ifdef USE_MPI
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    if (!finalized && line_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&line_comm);
+#endif
+}
+
+void Tridiagonal::createLineCommunicator(int color, int key) {
+
+#ifdef USE_MPI
+    if (line_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&line_comm);
+    MPI_Comm_split(MPI_COMM_WORLD, color, key, &line_comm);
+    MPI_Comm_rank(line_comm, &line_rank);
+    MPI_Comm_size(line_comm, &line_procs);
+#else
+    line_rank = 0;
+    line_procs = 1;
+#endif
+}
+
+void Tridiagonal::factorize(int n, int lines, const double *a, const double *d, const double *c,
+                            const double *a_first, const double *c_last) {
+
+    size = n;
+    num_lines = lines;
+
+    lower.assign(a, a + size * num_lines);
+    upper_mod.resize(size * num_lines);
+    inv_diag.resize(size * num_lines);
+
+    /* Forward elimination of the Thomas algorithm, the right hand side is not needed yet. */
+#pragma omp parallel for
+    for(int beg = 0; beg < num_lines; beg += LINE_BLOCK) {
+        int end = std::min(beg + LINE_BLOCK, num_lines);
+
+#pragma omp simd
+        for(int l = beg; l < end; ++l) {
+            inv_diag[l] = 1. / d[l];
+            upper_mod[l] = (size > 1) ? c[l] * inv_diag[l] : 0.0;
+        }
+
+        for(int k = 1; k < size; ++k) {
+            int cur = k * num_lines;
+            int prv = (k - 1) * num_lines;
+#pragma omp simd
+            for(int l = beg; l < end; ++l) {
+                inv_diag[cur + l] = 1. / (d[cur + l] - a[cur + l] * upper_mod[prv + l]);
+                upper_mod[cur + l] = (k < size - 1) ? c[cur + l] * inv_diag[cur + l] : 0.0;
+            }
+        }
+    }
+
+    if (line_procs == 1)
+        return;
+
+#ifdef USE_MPI
+    /*
+     * The local solution is x = y - v * x_prev - w * x_next, where x_prev and
+     * x_next are the unknowns of the neighboring segments and the spikes v and
+     * w do not depend on the right hand side. Compute them once.
+     */
+    vector<double> ends(4 * num_lines);
+
+    spike_prev.assign(size * num_lines, 0.0);
+    spike_next.assign(size * num_lines, 0.0);
+    for(int l = 0; l < num_lines; ++l) {
+        spike_prev[l] = a_first[l];
+        spike_next[(size - 1) * num_lines + l] = c_last[l];
+    }
+    solveLocal(spike_prev.data());
+    solveLocal(spike_next.data());
+
+    for(int l = 0; l < num_lines; ++l) {
+        ends[l] = spike_prev[l];
+        ends[num_lines + l] = spike_next[l];
+        ends[2 * num_lines + l] = spike_prev[(size - 1) * num_lines + l];
+        ends[3 * num_lines + l] = spike_next[(size - 1) * num_lines + l];
+    }
+
+    spikes_glob.resize(4 * num_lines * line_procs);
+    MPI_Allgather(ends.data(), 4 * num_lines, MPI_DOUBLE,
+                  spikes_glob.data(), 4 * num_lines, MPI_DOUBLE, line_comm);
+#endif
+}
+
+void Tridiagonal::solveLocal(double *rhs) const {
+
+#pragma omp parallel for
+    for(int beg = 0; beg < num_lines; beg += LINE_BLOCK) {
+        int end = std::min(beg + LINE_BLOCK, num_lines);
+
+#pragma omp simd
+        for(int l = beg; l < end; ++l) {
+            rhs[l] *= inv_diag[l];
+        }
+
+        /* Forward substitution */
+        for(int k = 1; k < size; ++k) {
+            int cur = k * num_lines;
+            int prv = (k - 1) * num_lines;
+#pragma omp simd
+            for(int l = beg; l < end; ++l) {
+                rhs[cur + l] = (rhs[cur + l] - lower[cur + l] * rhs[prv + l]) * inv_diag[cur + l];
+            }
+        }
+
+        /* Backward substitution */
+        for(int k = size - 2; k >= 0; --k) {
+            int cur = k * num_lines;
+            int nxt = (k + 1) * num_lines;
+#pragma omp simd
+            for(int l = beg; l < end; ++l) {
+                rhs[cur + l] -= upper_mod[cur + l] * rhs[nxt + l];
+            }
+        }
+    }
+}
+
+void Tridiagonal::solve(double *rhs) {
+
+    solveLocal(rhs);
+
+    if (line_procs == 1)
+        return;
+
+#ifdef USE_MPI
+    vector<double> ends(2 * num_lines);                     // Local solution at the segment ends
+    vector<double> ends_glob(2 * num_lines * line_procs);   // Same, for all segments of the lines
+    vector<double> prev(num_lines), next(num_lines);        // Unknowns of the neighboring segments
+
+    for(int l = 0; l < num_lines; ++l) {
+        ends[l] = rhs[l];
+        ends[num_lines + l] = rhs[(size - 1) * num_lines + l];
+    }
+
+    MPI_Allgather(ends.data(), 2 * num_lines, MPI_DOUBLE,
+                  ends_glob.data(), 2 * num_lines, MPI_DOUBLE, line_comm);
+
+    /* Every process solves the (small) reduced systems redundantly. */
+#pragma omp parallel for
+    for(int l = 0; l < num_lines; ++l) {
+        solveReduced(l, ends_glob, prev[l], next[l]);
+    }
+
+    /* Correct the local solution */
+#pragma omp parallel for
+    for(int k = 0; k < size; ++k) {
+        int cur = k * num_lines;
+#pragma omp simd
+        for(int l = 0; l < num_lines; ++l) {
+            rhs[cur + l] -= spike_prev[cur + l] * prev[l] + spike_next[cur + l] * next[l];
+        }
+    }
+#endif
+}
+
+void Tridiagonal::solveReduced(int line, const vector<double> &ends_glob, double &prev, double &next) const {
+
+    /*
+     * Unknowns of the reduced system are the first (F) and the last (L) unknowns
+     * of every segment p, stored as z = {F_0, L_0, F_1, L_1, ...}:
+     *   F_p + v_first * L_{p-1} + w_first * F_{p+1} = y_first
+     *   L_p + v_last  * L_{p-1} + w_last  * F_{p+1} = y_last
+     * The matrix is banded with two sub- and two super-diagonals. It is
+     * diagonally dominant for the M-matrices we solve, so no pivoting is done.
+     */
+    int m = 2 * line_procs;
+    vector<double> band(5 * m, 0.0);    // band[2 + c - r + 5 * r] stores entry (r, c)
+    vector<double> z(m, 0.0);
+
+    for(int p = 0; p < line_procs; ++p) {
+        const double *spikes = &spikes_glob[4 * num_lines * p];
+        const double *ends = &ends_glob[2 * num_lines * p];
+        int row_f = 2 * p;
+        int row_l = 2 * p + 1;
+
+        band[2 + 5 * row_f] = 1.;
+        band[2 + 5 * row_l] = 1.;
+        if (p > 0) {
+            band[1 + 5 * row_f] = spikes[line];
+            band[0 + 5 * row_l] = spikes[2 * num_lines + line];
+        }
+        if (p < line_procs - 1) {
+            band[4 + 5 * row_f] = spikes[num_lines + line];
+            band[3 + 5 * row_l] = spikes[3 * num_lines + line];
+        }
+        z[row_f] = ends[line];
+        z[row_l] = ends[num_lines + line];
+    }
+
+    /* Gaussian elimination */
+    for(int k = 0; k < m; ++k) {
+        for(int r = k + 1; r <= std::min(k + 2, m - 1); ++r) {
+            double factor = band[2 + k - r + 5 * r] / band[2 + 5 * k];
+            if (factor == 0.0)
+                continue;
+            for(int c = k; c <= std::min(k + 2, m - 1); ++c) {
+                band[2 + c - r + 5 * r] -= factor * band[2 + c - k + 5 * k];
+            }
+            z[r] -= factor * z[k];
+        }
+    }
+
+    /* Backward substitution */
+    for(int k = m - 1; k >= 0; --k) {
+        for(int c = k + 1; c <= std::min(k + 2, m - 1); ++c) {
+            z[k] -= band[2 + c - k + 5 * k] * z[c];
+        }
+        z[k] /= band[2 + 5 * k];
+    }
+
+    prev = (line_rank > 0) ? z[2 * line_rank - 1] : 0.0;
+    next = (line_rank < line_procs - 1) ? z[2 * line_rank + 2] : 0.0;
+}
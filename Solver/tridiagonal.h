@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2024 Maksim Masterov, SURF
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*!
+ * @file tridiagonal.h
+ * @brief Contains declaration of the \e Tridiagonal class.
+ */
+
+#ifndef TRIDIAGONAL_H_
+#define TRIDIAGONAL_H_
+
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include <vector>
+
+using namespace std;
+
+/*!
+ * @class Tridiagonal
+ * @brief Solves a batch of independent tridiagonal systems (lines).
+ *
+ * All arrays are stored with the line index running fastest, i.e. the k-th
+ * unknown of the l-th line is located at [l + k * num_lines]. This way the
+ * Thomas algorithm is vectorized across the lines.
+ *
+ * Lines may be split between several processes. In this case every process
+ * holds a segment of each line and the partitioned (spike) algorithm is used:
+ * the local segments are solved independently and the couplings between the
+ * segments are resolved through a small reduced system with two unknowns per
+ * segment.
+ */
+class Tridiagonal {
+    int size;                   // Number of local unknowns in each line
+    int num_lines;              // Number of lines
+    vector<double> lower;       // Sub-diagonal
+    vector<double> upper_mod;   // Modified super-diagonal (after forward elimination)
+    vector<double> inv_diag;    // Inverse of the modified diagonal
+    vector<double> spike_prev;  // Response of the segment to the previous segment
+    vector<double> spike_next;  // Response of the segment to the next segment
+    vector<double> spikes_glob; // Spikes at the ends of all segments of the line
+    int line_rank;              // Position of the local segment in the line
+    int line_procs;             // Number of segments in the line
+#ifdef USE_MPI
+    MPI_Comm line_comm;         // Communicator of the processes sharing the lines
+#endif
+
+public:
+    /*!
+     * @brief Default constructor.
+     */
+    Tridiagonal();
+
+    /*!
+     * @brief Destructor.
+     */
+    ~Tridiagonal();
+
+    Tridiagonal(const Tridiagonal&) = delete;
+    Tridiagonal& operator=(const Tridiagonal&) = delete;
+
+    /*!
+     * @brief Group processes that share the same lines.
+     * @note This is a collective call.
+     * @param color [in] Processes with the same color hold segments of the same lines
+     * @param key [in] Position of the local segment in the lines
+     */
+    void createLineCommunicator(int color, int key);
+
+    /*!
+     * @brief Factorize the batch of tridiagonal matrices.
+     * @note This is a collective call over the line communicator.
+     * @param n [in] Number of local unknowns in each line
+     * @param lines [in] Number of lines
+     * @param a [in] Sub-diagonal, a[0 * lines + l] is not used
+     * @param d [in] Diagonal
+     * @param c [in] Super-diagonal, c[(n - 1) * lines + l] is not used
+     * @param a_first [in] Coupling of the first unknown to the previous segment
+     * @param c_last [in] Coupling of the last unknown to the next segment
+     */
+    void factorize(int n, int lines, const double *a, const double *d, const double *c,
+                   const double *a_first, const double *c_last);
+
+    /*!
+     * @brief Solve the local segments with the Thomas algorithm, ignoring
+     *        the coupling between the segments.
+     * @param rhs [in/out] Right hand side, replaced with the solution
+     */
+    void solveLocal(double *rhs) const;
+
+    /*!
+     * @brief Solve the full lines, including coupling between the segments.
+     * @note This is a collective call over the line communicator.
+     * @param rhs [in/out] Right hand side, replaced with the solution
+     */
+    void solve(double *rhs);
+
+private:
+    /*!
+     * @brief Solve the reduced system for a single line.
+     * @param line [in] Index of the line
+     * @param ends_glob [in] Local solutions at the ends of all segments
+     * @param prev [out] Solution at the last unknown of the previous segment
+     * @param next [out] Solution at the first unknown of the next segment
+     */
+    void solveReduced(int line, const vector<double> &ends_glob, double &prev, double &next) const;
+};
+
+#endif /* TRIDIAGONAL_H_ */
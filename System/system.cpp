@@ -26,6 +26,7 @@
  */
 
 #include "../System/system.h"
+#include "../General/thread_pool.h"
 
 void System::allocateMemory(Dimensions &dims, Field &T, Matrix &A,
                             Vector &x, Vector &b) {
@@ -86,61 +87,70 @@ void System::assembleSystem(Faces &bondary_values, Field &T, Matrix &A,
     coefficients.south = -1.;
     coefficients.north = -1.;
 
-    for(int i = int_ind_i.beg; i <= int_ind_i.end; ++i) {
-        for(int j = int_ind_j.beg; j <= int_ind_j.end; ++j) {
+    /* Every line of cells fills its own rows, so the lines are independent. */
+    auto assembleLines = [&](int beg_i, int end_i) {
+        for(int i = beg_i; i < end_i; ++i) {
+            for(int j = int_ind_j.beg; j <= int_ind_j.end; ++j) {
 
-            int row = T.getID(i, j);          // current row id
-            int col = row;
+                int row = T.getID(i, j);          // current row id
+                int col = row;
             
-            /* Central coefficient and corresponding LHS and RHS */
-            A(row, row) = coefficients.central;
-            b(row) = 0.0;
-            x(row) = 0.0;
+                /* Central coefficient and corresponding LHS and RHS */
+                A(row, row) = coefficients.central;
+                b(row) = 0.0;
+                x(row) = 0.0;
             
-            /* Now, coefficients from the neighboring cells */
-            /* On west */
-            if (dims.getDecomposition().getPhysBound().west == PHYS_BOUNDARY && i == 0) {
-                A(row, row) -= coefficients.west;
-                b(row) -= 2. * coefficients.west * bondary_values.west;
-            }
-            else {
-                col = T.getID(i - 1, j);
-                A(row, col) = coefficients.west;
-            }
-
-            /* On east */
-            if (dims.getDecomposition().getPhysBound().east == PHYS_BOUNDARY &&
-                    i == T.getDimensions().getNumElts().i - 1) {
-                A(row, row) -= coefficients.east;
-                b(row) -= 2. * coefficients.east * bondary_values.east; 
-            }
-            else {
-                col = T.getID(i + 1, j);
-                A(row, col) = coefficients.east;
-            }
+                /* Now, coefficients from the neighboring cells */
+                /* On west */
+                if (dims.getDecomposition().getPhysBound().west == PHYS_BOUNDARY && i == 0) {
+                    A(row, row) -= coefficients.west;
+                    b(row) -= 2. * coefficients.west * bondary_values.west;
+                }
+                else {
+                    col = T.getID(i - 1, j);
+                    A(row, col) = coefficients.west;
+                }
+
+                /* On east */
+                if (dims.getDecomposition().getPhysBound().east == PHYS_BOUNDARY &&
+                        i == T.getDimensions().getNumElts().i - 1) {
+                    A(row, row) -= coefficients.east;
+                    b(row) -= 2. * coefficients.east * bondary_values.east; 
+                }
+                else {
+                    col = T.getID(i + 1, j);
+                    A(row, col) = coefficients.east;
+                }
             
-            /* On south */
-            if (dims.getDecomposition().getPhysBound().south == PHYS_BOUNDARY && j == 0) {
-                A(row, row) -= coefficients.south;
-                b(row) -= 2. * coefficients.south * bondary_values.south;
-            }
-            else {
-                col = T.getID(i, j - 1);
-                A(row, col) = coefficients.south;
-            }
-
-            /* On north */
-            if (dims.getDecomposition().getPhysBound().north == PHYS_BOUNDARY &&
-                    j == T.getDimensions().getNumElts().j - 1) {
-                A(row, row) -= coefficients.north;
-                b(row) -= 2. * coefficients.north * bondary_values.north;
-            }
-            else {
-                col = T.getID(i, j + 1);
-                A(row, col) = coefficients.north;
+                /* On south */
+                if (dims.getDecomposition().getPhysBound().south == PHYS_BOUNDARY && j == 0) {
+                    A(row, row) -= coefficients.south;
+                    b(row) -= 2. * coefficients.south * bondary_values.south;
+                }
+                else {
+                    col = T.getID(i, j - 1);
+                    A(row, col) = coefficients.south;
+                }
+
+                /* On north */
+                if (dims.getDecomposition().getPhysBound().north == PHYS_BOUNDARY &&
+                        j == T.getDimensions().getNumElts().j - 1) {
+                    A(row, row) -= coefficients.north;
+                    b(row) -= 2. * coefficients.north * bondary_values.north;
+                }
+                else {
+                    col = T.getID(i, j + 1);
+                    A(row, col) = coefficients.north;
+                }
             }
         }
-    }
+    };
+
+#ifdef USE_POOL
+    ThreadPool::getInstance().parallelFor(int_ind_i.beg, int_ind_i.end + 1, assembleLines);
+#else
+    assembleLines(int_ind_i.beg, int_ind_i.end + 1);
+#endif
 }
 
 void System::copySolution(Vector &x, Field &T) {
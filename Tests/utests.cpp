@@ -24,8 +24,17 @@
 #include "utests.h"
 #include "../MPI/common.h"
 #include "../General/dimensions.h"
+#include "../DataTypes/async_halo.h"
 #include "../System/system.h"
 #include "../Solver/solver.h"
+#include "../Solver/tridiagonal.h"
+#include "../Solver/relaxation.h"
+#include "../Solver/banded_cholesky.h"
+#include "../Solver/load_balancer.h"
+#include "../Solver/block_jacobi.h"
+#include "../MPI/reduction.h"
+#include "../MPI/threads.h"
+#include "../General/thread_pool.h"
 
 void Utests::passed(const string name) {
     if (getMyRank() == 0)
@@ -64,6 +73,20 @@ int Utests::runAll() {
     exit_status == EXIT_SUCCESS ? passed("vector halo/real cells 2d decomposition") :
                                   failed("vector halo/real cells 2d decomposition");
 
+    exit_status += vectorHaloPrecision2d();
+    exit_status == EXIT_SUCCESS ? passed("vector halo in reduced precision (2d)  ") :
+                                  failed("vector halo in reduced precision (2d)  ");
+
+#ifdef USE_MPI
+    exit_status += haloPlans2d();
+    exit_status == EXIT_SUCCESS ? passed("vector halo through every plan (2d)    ") :
+                                  failed("vector halo through every plan (2d)    ");
+
+    exit_status += asyncHalo2d();
+    exit_status == EXIT_SUCCESS ? passed("asynchronous vector halo (2d)          ") :
+                                  failed("asynchronous vector halo (2d)          ");
+#endif
+
     exit_status += fieldIDs2d();
     exit_status == EXIT_SUCCESS ? passed("enumeration of the field elements (2d) ") :
                                   failed("enumeration of the field elements (2d) ");
@@ -72,10 +95,85 @@ int Utests::runAll() {
     exit_status == EXIT_SUCCESS ? passed("matrix assembly (2d)                   ") :
                                   failed("matrix assembly (2d)                   ");
 
+#ifndef USE_THREADS
+    exit_status += tridiagonal1d();
+    exit_status == EXIT_SUCCESS ? passed("partitioned tridiagonal solver (1d)    ") :
+                                  failed("partitioned tridiagonal solver (1d)    ");
+#endif
+
+    exit_status += bandedCholesky2d();
+    exit_status == EXIT_SUCCESS ? passed("banded Cholesky solver (2d)            ") :
+                                  failed("banded Cholesky solver (2d)            ");
+
+    exit_status += relaxationFactor();
+    exit_status == EXIT_SUCCESS ? passed("tuning of the relaxation factor        ") :
+                                  failed("tuning of the relaxation factor        ");
+
+    exit_status += processGrid();
+    exit_status == EXIT_SUCCESS ? passed("automatic process grid                 ") :
+                                  failed("automatic process grid                 ");
+
+    exit_status += nodeGrid();
+    exit_status == EXIT_SUCCESS ? passed("node-aware tiles of the process grid   ") :
+                                  failed("node-aware tiles of the process grid   ");
+
+    exit_status += weightedDecomposition1d();
+    exit_status == EXIT_SUCCESS ? passed("weighted 1d decomposition              ") :
+                                  failed("weighted 1d decomposition              ");
+
+#ifndef USE_THREADS
+    exit_status += migration2d();
+    exit_status == EXIT_SUCCESS ? passed("migration of a vector (2d)             ") :
+                                  failed("migration of a vector (2d)             ");
+#endif
+
+    exit_status += deepHalo2d();
+    exit_status == EXIT_SUCCESS ? passed("sweeps with a deep halo (2d)           ") :
+                                  failed("sweeps with a deep halo (2d)           ");
+
+    exit_status += blocks2d();
+    exit_status == EXIT_SUCCESS ? passed("over-decomposition into blocks (2d)    ") :
+                                  failed("over-decomposition into blocks (2d)    ");
+
+    exit_status += blockDataflow2d();
+    exit_status == EXIT_SUCCESS ? passed("sweeps of the blocks as a task graph   ") :
+                                  failed("sweeps of the blocks as a task graph   ");
+
+    exit_status += reductions();
+    exit_status == EXIT_SUCCESS ? passed("flat and hierarchical reductions       ") :
+                                  failed("flat and hierarchical reductions       ");
+
+    exit_status += overlappedSweeps2d();
+    exit_status == EXIT_SUCCESS ? passed("sweeps overlapped with the halo (2d)   ") :
+                                  failed("sweeps overlapped with the halo (2d)   ");
+
+#ifdef USE_POOL
+    exit_status += threadPool();
+    exit_status == EXIT_SUCCESS ? passed("work-stealing thread pool              ") :
+                                  failed("work-stealing thread pool              ");
+#endif
+
+#ifdef USE_THREADS
+    exit_status += threadMailboxes();
+    exit_status == EXIT_SUCCESS ? passed("mailboxes of the thread ranks          ") :
+                                  failed("mailboxes of the thread ranks          ");
+#endif
+
+    /* These rely on Solver::calculateNorm() of the exercise, hence the last ones */
     exit_status += norm2d();
     exit_status == EXIT_SUCCESS ? passed("L2-norm (2d)                           ") :
                                   failed("L2-norm (2d)                           ");
 
+    exit_status += anderson2d();
+    exit_status == EXIT_SUCCESS ? passed("Anderson acceleration (2d)             ") :
+                                  failed("Anderson acceleration (2d)             ");
+
+#ifndef USE_THREADS
+    exit_status += asyncSolver2d();
+    exit_status == EXIT_SUCCESS ? passed("asynchronous relaxation (2d)           ") :
+                                  failed("asynchronous relaxation (2d)           ");
+#endif
+
     if (exit_status == 0)
         return EXIT_SUCCESS;
     else
@@ -94,13 +192,13 @@ int Utests::decomposition1d() {
 
     if (dims.getNumEltsLoc().j != 10)
         check = EXIT_FAILURE;
-    if (my_rank == 0 && dims.getNumEltsLoc().i != 2)
+    if (my_rank == 0 && dims.getNumEltsLoc().i != 3)
         check = EXIT_FAILURE;
-    if (my_rank == 1 && dims.getNumEltsLoc().i != 2)
+    if (my_rank == 1 && dims.getNumEltsLoc().i != 3)
         check = EXIT_FAILURE;
     if (my_rank == 2 && dims.getNumEltsLoc().i != 2)
         check = EXIT_FAILURE;
-    if (my_rank == 3 && dims.getNumEltsLoc().i != 4)
+    if (my_rank == 3 && dims.getNumEltsLoc().i != 2)
         check = EXIT_FAILURE;
 
     // This one is based on the assumtion that EXIT_SUCCESS is always 0
@@ -118,13 +216,13 @@ int Utests::decomposition2d() {
 
     dims.decompose(num_procs);
 
-    if (my_rank == 0 && (dims.getNumEltsLoc().i != 2 || dims.getNumEltsLoc().j != 2))
+    if (my_rank == 0 && (dims.getNumEltsLoc().i != 3 || dims.getNumEltsLoc().j != 3))
         check = EXIT_FAILURE;
-    if (my_rank == 1 && (dims.getNumEltsLoc().i != 2 || dims.getNumEltsLoc().j != 3))
+    if (my_rank == 1 && (dims.getNumEltsLoc().i != 3 || dims.getNumEltsLoc().j != 2))
         check = EXIT_FAILURE;
-    if (my_rank == 2 && (dims.getNumEltsLoc().i != 3 || dims.getNumEltsLoc().j != 2))
+    if (my_rank == 2 && (dims.getNumEltsLoc().i != 2 || dims.getNumEltsLoc().j != 3))
         check = EXIT_FAILURE;
-    if (my_rank == 3 && (dims.getNumEltsLoc().i != 3 || dims.getNumEltsLoc().j != 3))
+    if (my_rank == 3 && (dims.getNumEltsLoc().i != 2 || dims.getNumEltsLoc().j != 2))
         check = EXIT_FAILURE;
 
     // This one is based on the assumtion that EXIT_SUCCESS is always 0
@@ -145,8 +243,8 @@ int Utests::matrixHalo1d() {
     
     A.resize(dims);
 
-    if (my_rank == 0 && (A.getLocElts() != 5 || A.getHaloElts() != 5 ||
-                         A.numRows() != 5 || A.numCols() != 10))
+    if (my_rank == 0 && (A.getLocElts() != 10 || A.getHaloElts() != 5 ||
+                         A.numRows() != 10 || A.numCols() != 15))
         check = EXIT_FAILURE;
     if (my_rank == 1 && (A.getLocElts() != 5 || A.getHaloElts() != 10 ||
                          A.numRows() != 5 || A.numCols() != 15))
@@ -154,8 +252,8 @@ int Utests::matrixHalo1d() {
     if (my_rank == 2 && (A.getLocElts() != 5 || A.getHaloElts() != 10 ||
                          A.numRows() != 5 || A.numCols() != 15))
         check = EXIT_FAILURE;
-    if (my_rank == 3 && (A.getLocElts() != 10 || A.getHaloElts() != 5 ||
-                         A.numRows() != 10 || A.numCols() != 15))
+    if (my_rank == 3 && (A.getLocElts() != 5 || A.getHaloElts() != 5 ||
+                         A.numRows() != 5 || A.numCols() != 10))
         check = EXIT_FAILURE;
 
     // This one is based on the assumtion that EXIT_SUCCESS is always 0
@@ -176,8 +274,8 @@ int Utests::matrixHalo2d() {
     
     A.resize(dims);
 
-    if (my_rank == 0 && (A.getLocElts() != 4 || A.getHaloElts() != 4 || 
-                         A.numRows() != 4 || A.numCols() != 8))
+    if (my_rank == 0 && (A.getLocElts() != 9 || A.getHaloElts() != 6 ||
+                         A.numRows() != 9 || A.numCols() != 15))
         check = EXIT_FAILURE;
     if (my_rank == 1 && (A.getLocElts() != 6 || A.getHaloElts() != 5 ||
                          A.numRows() != 6 || A.numCols() != 11))
@@ -185,8 +283,8 @@ int Utests::matrixHalo2d() {
     if (my_rank == 2 && (A.getLocElts() != 6 || A.getHaloElts() != 5 ||
                          A.numRows() != 6 || A.numCols() != 11))
         check = EXIT_FAILURE;
-    if (my_rank == 3 && (A.getLocElts() != 9 || A.getHaloElts() != 6 ||
-                         A.numRows() != 9 || A.numCols() != 15))
+    if (my_rank == 3 && (A.getLocElts() != 4 || A.getHaloElts() != 4 ||
+                         A.numRows() != 4 || A.numCols() != 8))
         check = EXIT_FAILURE;
 
     // This one is based on the assumtion that EXIT_SUCCESS is always 0
@@ -207,8 +305,8 @@ int Utests::vectorHalo1d() {
     
     x.resize(dims);
 
-    if (my_rank == 0 && (x.getLocElts() != 5 || x.getHaloElts() != 5 ||
-                         x.numRows() != 10 || x.numCols() != 1))
+    if (my_rank == 0 && (x.getLocElts() != 10 || x.getHaloElts() != 5 ||
+                         x.numRows() != 15 || x.numCols() != 1))
         check = EXIT_FAILURE;
     if (my_rank == 1 && (x.getLocElts() != 5 || x.getHaloElts() != 10 ||
                          x.numRows() != 15 || x.numCols() != 1))
@@ -216,8 +314,8 @@ int Utests::vectorHalo1d() {
     if (my_rank == 2 && (x.getLocElts() != 5 || x.getHaloElts() != 10 ||
                          x.numRows() != 15 || x.numCols() != 1))
         check = EXIT_FAILURE;
-    if (my_rank == 3 && (x.getLocElts() != 10 || x.getHaloElts() != 5 ||
-                         x.numRows() != 15 || x.numCols() != 1))
+    if (my_rank == 3 && (x.getLocElts() != 5 || x.getHaloElts() != 5 ||
+                         x.numRows() != 10 || x.numCols() != 1))
         check = EXIT_FAILURE;
 
     // cout << my_rank << " " << x.getLocElts() << " " << x.getHaloElts() << " "
@@ -240,8 +338,8 @@ int Utests::vectorHalo2d() {
     
     x.resize(dims);
 
-    if (my_rank == 0 && (x.getLocElts() != 4 || x.getHaloElts() != 4 ||
-                         x.numRows() != 8 || x.numCols() != 1))
+    if (my_rank == 0 && (x.getLocElts() != 9 || x.getHaloElts() != 6 ||
+                         x.numRows() != 15 || x.numCols() != 1))
         check = EXIT_FAILURE;
     if (my_rank == 1 && (x.getLocElts() != 6 || x.getHaloElts() != 5 ||
                          x.numRows() != 11 || x.numCols() != 1))
@@ -249,8 +347,8 @@ int Utests::vectorHalo2d() {
     if (my_rank == 2 && (x.getLocElts() != 6 || x.getHaloElts() != 5 ||
                          x.numRows() != 11 || x.numCols() != 1))
         check = EXIT_FAILURE;
-    if (my_rank == 3 && (x.getLocElts() != 9 || x.getHaloElts() != 6 ||
-                         x.numRows() != 15 || x.numCols() != 1))
+    if (my_rank == 3 && (x.getLocElts() != 4 || x.getHaloElts() != 4 ||
+                         x.numRows() != 8 || x.numCols() != 1))
         check = EXIT_FAILURE;
 
     // This one is based on the assumtion that EXIT_SUCCESS is always 0
@@ -258,13 +356,165 @@ int Utests::vectorHalo2d() {
     return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
+int Utests::vectorHaloPrecision2d() {
+    Dimensions dims;
+    int check = EXIT_SUCCESS;
+    Vector x, y;
+    IndicesIJ num_procs = {2, 2};
+
+    dims.setNumEltsGlob({5, 5});
+
+    dims.decompose(num_procs);
+
+    x.resize(dims);
+    y.resize(dims);
+    x.setHaloPrecision(PRECISION_DELTA);
+
+    /* The second exchange sends small changes, which are nearly exact as float */
+    for(int step = 0; step < 2; ++step) {
+        for(int n = 0; n < x.getLocElts(); ++n) {
+            x(n) = y(n) = 1. / 3. + n + getMyRank() + 1e-3 * step;
+        }
+        x.exchangeRealHalo();
+        y.exchangeRealHalo();
+
+        double tolerance = (step == 0) ? 1e-5 : 1e-9;
+        for(int n = x.getLocElts(); n < x.numRows(); ++n) {
+            if (std::abs(x(n) - y(n)) > tolerance)
+                check = EXIT_FAILURE;
+        }
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#ifdef USE_MPI
+int Utests::haloPlans2d() {
+    Dimensions dims_p2p;
+    int check = EXIT_SUCCESS;
+    Vector ref;
+    IndicesIJ num_procs = {2, 2};
+    /* Every way of the exchange, nonblocking or not, in full or reduced precision */
+    const int halo_comm[] = {HALO_P2P, HALO_NEIGHBOR, HALO_SHARED, HALO_RMA};
+    const int precision[] = {PRECISION_DOUBLE, PRECISION_FLOAT};
+
+    dims_p2p.setNumEltsGlob({9, 7});
+    dims_p2p.setHaloComm(HALO_P2P);
+    dims_p2p.decompose(num_procs);
+    ref.resize(dims_p2p);
+
+    for(int comm : halo_comm) {
+        for(int prec : precision) {
+            for(int split = 0; split < 2; ++split) {
+                Dimensions dims;
+                Vector x;
+
+                dims.setNumEltsGlob({9, 7});
+                dims.setHaloComm(comm);
+                dims.decompose(num_procs);
+                x.resize(dims);
+                x.setHaloPrecision(prec);
+                if (x.getLocElts() != ref.getLocElts() || x.numRows() != ref.numRows()) {
+                    check = EXIT_FAILURE;
+                    continue;
+                }
+
+                /* Several exchanges reuse the requests and the slots of the windows */
+                for(int step = 0; step < 3; ++step) {
+                    for(int n = 0; n < x.getLocElts(); ++n)
+                        x(n) = ref(n) = 1. / 3. + n + 100. * getMyRank() + step;
+                    ref.exchangeRealHalo();
+                    if (split == 1) {
+                        x.startHaloExchange();
+                        x.finishHaloExchange();
+                    }
+                    else {
+                        x.exchangeRealHalo();
+                    }
+
+                    /* Only the persistent requests round the messages to float */
+                    double tolerance = (prec == PRECISION_FLOAT) ? 1e-4 : 0.;
+                    for(int n = x.getLocElts(); n < x.numRows(); ++n) {
+                        if (std::abs(x(n) - ref(n)) > tolerance)
+                            check = EXIT_FAILURE;
+                    }
+                }
+            }
+        }
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::asyncHalo2d() {
+    Dimensions dims;
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, b;
+    Faces boundary_values;
+    Stencil stencil;
+    int check = EXIT_SUCCESS;
+    int my_rank = getMyRank();
+    IndicesIJ num_procs = {2, 2};
+    double num_sent = 0., num_received = 0.;
+
+    dims.setNumEltsGlob({9, 7});
+    dims.decompose(num_procs);
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    stencil.assemble(A, T);
+
+    {
+        AsyncHalo halo(x);
+
+        /* Processes relax at different pace, so messages are still in flight at the end */
+        halo.start();
+        for(int k = 0; k < 5 + 10 * my_rank; ++k) {
+            for(int n = 0; n < x.getLocElts(); ++n)
+                x(n) = (b(n) - stencil.offDiagonal(x.getData(), n)) / stencil.getCentral(n);
+            halo.progress();
+        }
+        halo.finish();
+
+        Neighbors ngb = dims.getDecomposition().getNgbPid();
+        int ngb_pid[HALO_NUM_DIRS] = {ngb.west, ngb.east, ngb.south, ngb.north};
+        for(int dir = 0; dir < HALO_NUM_DIRS; ++dir) {
+            if (ngb_pid[dir] != EMPTY && halo.getNumSent(dir) < 1)
+                check = EXIT_FAILURE;
+            num_sent += halo.getNumSent(dir);
+            num_received += halo.getNumReceived(dir);
+        }
+    }
+
+    /* Every message sent has been received */
+    findGlobalSum(num_sent);
+    findGlobalSum(num_received);
+    if (num_sent != num_received)
+        check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
 int Utests::fieldIDs2d() {
 
-    int ref_data[4][16] = {{0, 1, 4, 2, 3, 5, 6, 7, -1, -2, -2, -2, -2, -2, -2, -2},
-                           {6, 0, 1, 2, 7, 3, 4, 5, -1, 8, 9, 10, -2, -2, -2, -2},
-                           {6, 7, -1, 0, 1, 8, 2, 3, 9, 4, 5, 10, -2, -2, -2, -2},
-                           {-1, 9, 10, 11, 12, 0, 1, 2, 13, 3, 4, 5, 14, 6, 7, 8}};
-    int ref_data_size[4] = {9, 12, 12, 16};
+    int ref_data[4][16] = {{0, 1, 2, 9, 3, 4, 5, 10, 6, 7, 8, 11, 12, 13, 14, -1},
+                           {6, 0, 1, 7, 2, 3, 8, 4, 5, -1, 9, 10, -2, -2, -2, -2},
+                           {6, 7, 8, -1, 0, 1, 2, 9, 3, 4, 5, 10, -2, -2, -2, -2},
+                           {-1, 4, 5, 6, 0, 1, 7, 2, 3, -2, -2, -2, -2, -2, -2, -2}};
+    int ref_data_size[4] = {16, 12, 12, 9};
     IndicesIJ num_procs = {2, 2};
 
     Dimensions dims;
@@ -294,11 +544,11 @@ int Utests::fieldIDs2d() {
 
 int Utests::matrixAssembly2d() {
 
-    int ref_data[4][39] = {{6, -1, -1, -1,  5, -1, -1, -1,  5, -1, -1, -1, -1,  4, -1, -1, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2},
-                           {5, -1, -1, -1, -1,  5, -1, -1, -1,  6, -1, -1,  4, -1, -1, -1, -1, -1,  4, -1, -1, -1, -1,  5, -1, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2},
-                           {5, -1, -1, -1, -1,  4, -1, -1, -1, -1,  5, -1, -1, -1, -1,  4, -1, -1, -1,  6, -1, -1, -1,  5, -1, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2},
-                           {4, -1, -1, -1, -1, -1,  4, -1, -1, -1, -1,  5, -1, -1, -1,  4, -1, -1, -1, -1, -1,  4, -1, -1, -1, -1,  5, -1, -1,  5, -1, -1, -1, -1,  5, -1, -1, -1,  6}};
-    int ref_data_size[4] = {16, 25, 25, 39};
+    int ref_data[4][39] = {{6, -1, -1, -1,  5, -1, -1, -1,  5, -1, -1, -1,  5, -1, -1, -1, -1,  4, -1, -1, -1, -1,  4, -1, -1, -1,  5, -1, -1, -1, -1,  4, -1, -1, -1, -1,  4, -1, -1},
+                           {5, -1, -1, -1, -1,  6, -1, -1,  4, -1, -1, -1, -1, -1,  5, -1, -1,  4, -1, -1, -1, -1, -1,  5, -1, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2},
+                           {5, -1, -1, -1, -1,  4, -1, -1, -1, -1,  4, -1, -1, -1, -1,  6, -1, -1, -1,  5, -1, -1, -1,  5, -1, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2},
+                           {4, -1, -1, -1, -1, -1,  5, -1, -1, -1,  5, -1, -1, -1, -1,  6, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2}};
+    int ref_data_size[4] = {39, 25, 25, 16};
     IndicesIJ num_procs = {2, 2};
 
     System system;
@@ -382,10 +632,15 @@ int Utests::norm2d() {
     x.resize(dims);
 
     if (my_rank == 0) {
-        x(0) = 3.1;
-        x(1) = 4.8;
+        x(0) = 8.6;
+        x(1) = 1.1;
         x(2) = 9;
-        x(3) = 3.5;
+        x(3) = 6.5;
+        x(4) = 9.9;
+        x(5) = 16;
+        x(6) = 7.7;
+        x(7) = 8.9;
+        x(8) = 5.6;
     }
     if (my_rank == 1) {
         x(0) = 1.1;
@@ -404,15 +659,10 @@ int Utests::norm2d() {
         x(5) = 8.4;
     }
     if (my_rank == 3) {
-        x(0) = 8.6;
-        x(1) = 1.1;
+        x(0) = 3.1;
+        x(1) = 4.8;
         x(2) = 9;
-        x(3) = 6.5;
-        x(4) = 9.9;
-        x(5) = 16;
-        x(6) = 7.7;
-        x(7) = 8.9;
-        x(8) = 5.6;
+        x(3) = 3.5;
     }
 
     if (fabs(answer - solver.calculateNorm(x)) > 1e-12)
@@ -422,3 +672,830 @@ int Utests::norm2d() {
     findGlobalSum(check);
     return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
+
+int Utests::anderson2d() {
+    Dimensions dims;
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, x_aa, b, res;
+    Faces boundary_values;
+    Solver solver, solver_aa;
+    SolverSettings settings;
+    int check = EXIT_SUCCESS;
+    int iter = 0;
+    double norm_b = 0.0;
+    IndicesIJ num_procs = {2, 2};
+    streambuf *cout_buf = cout.rdbuf();
+
+    dims.setNumEltsGlob({9, 7});
+    dims.decompose(num_procs);
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    x_aa.resize(dims);
+    res.resize(dims);
+    for(int n = 0; n < x.numRows(); ++n)
+        x_aa(n) = x(n);
+
+    /* Normalized residual, computed without the routines of the solver */
+    auto residualNorm = [&](Vector &vec) {
+        double sum = 0.0;
+        vec.exchangeRealHalo();
+        solver.stencil.calculateResidual(vec, b, res);
+        for(int n = 0; n < res.getLocElts(); ++n)
+            sum += res(n) * res(n);
+        findGlobalSum(sum);
+        return sqrt(sum) / norm_b;
+    };
+
+    /* Plain damped Jacobi sweeps */
+    solver.setSettings(settings);
+    solver.setupIteration(A, x, T);
+    for(int n = 0; n < b.getLocElts(); ++n)
+        norm_b += b(n) * b(n);
+    findGlobalSum(norm_b);
+    norm_b = sqrt(norm_b);
+
+    x.exchangeRealHalo();
+    while (iter < settings.max_iter && residualNorm(x) > settings.tolerance) {
+        solver.iterate(2./3., x, b);
+        ++iter;
+    }
+    if (iter == settings.max_iter)
+        check = EXIT_FAILURE;
+
+    /* The same sweeps accelerated by AA(5) need less than half of the iterations */
+    settings.anderson_depth = 5;
+    settings.max_iter = iter / 2;
+    solver_aa.setSettings(settings);
+    /* Only the root prints the iterations, the ranks may be threads sharing cout */
+    if (getMyRank() == 0)
+        cout.rdbuf(nullptr);
+    solver_aa.solve(A, x_aa, b, T);
+    if (getMyRank() == 0) {
+        cout.rdbuf(cout_buf);
+        cout.clear();
+    }
+
+    if (residualNorm(x_aa) > settings.tolerance)
+        check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#ifndef USE_THREADS
+int Utests::asyncSolver2d() {
+    Dimensions dims;
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, b, res;
+    Faces boundary_values;
+    Solver solver;
+    SolverSettings settings;
+    int check = EXIT_SUCCESS;
+    double norm_b = 0.0, norm_res = 0.0;
+    IndicesIJ num_procs = {2, 2};
+    streambuf *cout_buf = cout.rdbuf();
+
+    dims.setNumEltsGlob({24, 20});
+    dims.decompose(num_procs);
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    res.resize(dims);
+
+    settings.type = SOLVER_ASYNC;
+    solver.setSettings(settings);
+    if (getMyRank() == 0)
+        cout.rdbuf(nullptr);
+    solver.solve(A, x, b, T);
+    if (getMyRank() == 0) {
+        cout.rdbuf(cout_buf);
+        cout.clear();
+    }
+
+    /* The residual the solver stopped at holds for the final, consistent iterate */
+    x.exchangeRealHalo();
+    solver.stencil.calculateResidual(x, b, res);
+    for(int n = 0; n < res.getLocElts(); ++n) {
+        norm_res += res(n) * res(n);
+        norm_b += b(n) * b(n);
+    }
+    findGlobalSum(norm_res);
+    findGlobalSum(norm_b);
+    if (sqrt(norm_res) / sqrt(norm_b) > settings.tolerance)
+        check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
+int Utests::tridiagonal1d() {
+
+    Tridiagonal lines;
+    int check = EXIT_SUCCESS;
+    int my_rank = getMyRank();
+    int num_procs = getNumProcs();
+    const int n = 3;                    // Local number of unknowns in each line
+    const int num_lines = 2;
+    vector<double> a(n * num_lines, -1.), d(n * num_lines, 4.), c(n * num_lines, -1.);
+    vector<double> a_first(num_lines, -1.), c_last(num_lines, -1.);
+    vector<double> rhs(n * num_lines);
+
+    /* All processes hold consecutive segments of the same two lines */
+    if (my_rank == 0)
+        a_first.assign(num_lines, 0.);
+    if (my_rank == num_procs - 1)
+        c_last.assign(num_lines, 0.);
+
+    /*
+     * The exact solution is x = (global index + 1) * (line + 1), the right hand
+     * side follows from the (-1, 4, -1) rows.
+     */
+    for(int k = 0; k < n; ++k) {
+        for(int l = 0; l < num_lines; ++l) {
+            int glob = k + n * my_rank;
+            int glob_max = n * num_procs - 1;
+            double value = 4. * (glob + 1);
+            if (glob > 0)
+                value -= glob;
+            if (glob < glob_max)
+                value -= glob + 2;
+            rhs[l + k * num_lines] = value * (l + 1);
+        }
+    }
+
+    lines.createLineCommunicator(0, my_rank);
+    lines.factorize(n, num_lines, a.data(), d.data(), c.data(), a_first.data(), c_last.data());
+    lines.solve(rhs.data());
+
+    for(int k = 0; k < n; ++k) {
+        for(int l = 0; l < num_lines; ++l) {
+            double answer = (k + n * my_rank + 1) * (l + 1);
+            if (fabs(answer - rhs[l + k * num_lines]) > 1e-12)
+                check = EXIT_FAILURE;
+        }
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::bandedCholesky2d() {
+
+    BandedCholesky cholesky;
+    int check = EXIT_SUCCESS;
+    const int ni = 4, nj = 3;           // Local grid, the same on every process
+    const int size = ni * nj;
+    const int width = nj + 1;
+    vector<double> band(size * width, 0.0);
+    vector<double> answer(size), rhs(size);
+
+    /* 5-point stencil (-1, -1, 4, -1, -1) in the natural ordering j + i * nj */
+    for(int i = 0; i < ni; ++i) {
+        for(int j = 0; j < nj; ++j) {
+            int n = j + i * nj;
+            band[nj + n * width] = 4.;
+            if (i > 0)
+                band[n * width] = -1.;
+            if (j > 0)
+                band[nj - 1 + n * width] = -1.;
+            answer[n] = n + 1.;
+        }
+    }
+
+    for(int i = 0; i < ni; ++i) {
+        for(int j = 0; j < nj; ++j) {
+            int n = j + i * nj;
+            rhs[n] = 4. * answer[n];
+            if (i > 0)
+                rhs[n] -= answer[n - nj];
+            if (i < ni - 1)
+                rhs[n] -= answer[n + nj];
+            if (j > 0)
+                rhs[n] -= answer[n - 1];
+            if (j < nj - 1)
+                rhs[n] -= answer[n + 1];
+        }
+    }
+
+    if (cholesky.factorize(size, nj, band) != EXIT_SUCCESS)
+        check = EXIT_FAILURE;
+
+    /* Solve twice to make sure the factors are kept */
+    for(int rep = 0; rep < 2 && check == EXIT_SUCCESS; ++rep) {
+        vector<double> x = rhs;
+        cholesky.solve(x.data());
+        for(int n = 0; n < size; ++n) {
+            if (fabs(answer[n] - x[n]) > 1e-12)
+                check = EXIT_FAILURE;
+        }
+    }
+
+    /* A matrix which is not positive definite must be rejected */
+    band[nj] = -4.;
+    if (cholesky.factorize(size, nj, band) != EXIT_FAILURE || cholesky.isFactorized())
+        check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::relaxationFactor() {
+    int check = EXIT_SUCCESS;
+    double lambda_min = 0.01, lambda_max = 1.9, mu = 0.99;
+
+    /* Damped Jacobi: the residual drops by 1 - omega * lambda_min per sweep */
+    for(int num_sweeps = 1; num_sweeps <= 3; num_sweeps += 2) {
+        Relaxation relaxation(2./3.);
+        double rate = pow(1. - 2./3. * lambda_min, num_sweeps);
+        double residual = 1.;
+        bool updated = false;
+
+        relaxation.setSpectrumBound(lambda_max);
+        for(int k = 0; k < 20 && !updated; ++k) {
+            updated = relaxation.updateJacobi(residual, num_sweeps);
+            residual *= rate;
+        }
+        if (!updated || fabs(relaxation.getOmega() - 2. / (lambda_min + lambda_max)) > 1e-6)
+            check = EXIT_FAILURE;
+    }
+
+    /* Gauss-Seidel: the residual drops by mu^2, SOR is optimal at 2 / (1 + sqrt(1 - mu^2)) */
+    {
+        Relaxation relaxation(1.);
+        double residual = 1.;
+        bool updated = false;
+
+        for(int k = 0; k < 20 && !updated; ++k) {
+            updated = relaxation.updateSOR(residual);
+            residual *= mu * mu;
+        }
+        if (!updated || fabs(relaxation.getOmega() - 2. / (1. + sqrt(1. - mu * mu))) > 1e-6)
+            check = EXIT_FAILURE;
+    }
+
+    /* A factor that is already optimal is kept */
+    {
+        Relaxation relaxation(2. / (lambda_min + lambda_max));
+        double residual = 1.;
+
+        relaxation.setSpectrumBound(lambda_max);
+        for(int k = 0; k < 20; ++k) {
+            if (relaxation.updateJacobi(residual))
+                check = EXIT_FAILURE;
+            residual *= 1. - relaxation.getOmega() * lambda_min;
+        }
+    }
+
+    /* The bound from the stencil is the one from the rows of the matrix */
+    {
+        Dimensions dims;
+        System system;
+        Field T;
+        Matrix A;
+        Vector x, b;
+        Faces boundary_values;
+        Solver solver;
+        IndicesIJ num_procs = {2, 2};
+        double bound = 0.0;
+
+        dims.setNumEltsGlob({9, 7});
+        dims.decompose(num_procs);
+        boundary_values.east = 10.;
+        boundary_values.west = 11.;
+        boundary_values.south = 12.;
+        boundary_values.north = 13.;
+        system.allocateMemory(dims, T, A, x, b);
+        system.assembleSystem(boundary_values, T, A, x, b);
+        solver.stencil.assemble(A, T);
+
+        for(int i = 0; i < A.numRows(); ++i) {
+            double sum = 0.0;
+            for(int j = 0; j < A.numCols(); ++j) {
+                if (j != i)
+                    sum += fabs(A(i, j));
+            }
+            bound = std::max(bound, 1. + sum / fabs(A(i, i)));
+        }
+        findGlobalMax(bound);
+        if (fabs(solver.findSpectrumBound(solver.stencil) - bound) > 1e-12)
+            check = EXIT_FAILURE;
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::processGrid() {
+
+    int check = EXIT_SUCCESS;
+    const int num_cases = 7;
+    /* Number of processes, global cells (i j) and the expected grid (i j) */
+    const int cases[num_cases][5] = {
+        {4,  40,  40,  2, 2},
+        {4, 100,  10,  4, 1},
+        {4,  10, 100,  1, 4},
+        {6,  60,  40,  3, 2},
+        {7,  30,  50,  1, 7},
+        {12, 120, 30,  6, 2},
+        {1,  10,  10,  1, 1}
+    };
+
+    for(int c = 0; c < num_cases; ++c) {
+        IndicesIJ grid = Decomposition::findProcessGrid(cases[c][0],
+                                                        IndicesIJ(cases[c][1], cases[c][2]));
+        if (grid.i != cases[c][3] || grid.j != cases[c][4])
+            check = EXIT_FAILURE;
+    }
+
+    return check;
+}
+
+int Utests::nodeGrid() {
+
+    int check = EXIT_SUCCESS;
+    const int num_cases = 5;
+    /* Number of nodes, process grid (i j), global cells (i j) and the expected node grid (i j) */
+    const int cases[num_cases][7] = {
+        {2, 2, 2,  40,  40, 1, 2},
+        {4, 4, 2,  40,  40, 2, 2},
+        {2, 4, 4, 100,  10, 2, 1},
+        {3, 4, 4,  40,  40, 0, 0},
+        {1, 3, 5,  10,  10, 1, 1}
+    };
+
+    for(int c = 0; c < num_cases; ++c) {
+        IndicesIJ grid = Decomposition::findNodeGrid(cases[c][0],
+                                                     IndicesIJ(cases[c][1], cases[c][2]),
+                                                     IndicesIJ(cases[c][3], cases[c][4]));
+        if (grid.i != cases[c][5] || grid.j != cases[c][6])
+            check = EXIT_FAILURE;
+    }
+
+    return check;
+}
+
+int Utests::weightedDecomposition1d() {
+    Dimensions dims;
+    int check = EXIT_SUCCESS;
+    int my_rank = getMyRank();
+    IndicesIJ num_procs = {4, 1};
+    /* Shares are 3.75, 3.75, 1.25, 1.25: the two largest fractions get the rest */
+    int ref_size[4] = {4, 4, 1, 1};
+    int ref_beg[4] = {0, 4, 8, 9};
+
+    dims.setNumEltsGlob({10, 10});
+    dims.setWeight(my_rank < 2 ? 3.0 : 1.0);
+
+    dims.decompose(num_procs);
+
+    if (dims.getNumEltsLoc().j != 10 || dims.getBegIndicesGlob().j != 0)
+        check = EXIT_FAILURE;
+    if (dims.getNumEltsLoc().i != ref_size[my_rank] ||
+        dims.getBegIndicesGlob().i != ref_beg[my_rank])
+        check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::migration2d() {
+    Dimensions dims;
+    Dimensions new_dims;
+    Vector vec;
+    int check = EXIT_SUCCESS;
+    int my_rank = getMyRank();
+    IndicesIJ num_procs = {2, 2};
+    IndicesIJ elts_loc, beg_ind;
+
+    dims.setNumEltsGlob({5, 5});
+    dims.decompose(num_procs);
+    vec.resize(dims);
+
+    /* Every element holds its global ID */
+    elts_loc = dims.getNumEltsLoc();
+    beg_ind = dims.getBegIndicesGlob();
+    for(int i = 0; i < elts_loc.i; ++i)
+        for(int j = 0; j < elts_loc.j; ++j)
+            vec(j + i * elts_loc.j) = (j + beg_ind.j) + (i + beg_ind.i) * 5;
+
+    /* The last process is the fastest one, so the cut lines move to the origin */
+    new_dims = dims;
+    new_dims.setWeight(my_rank == 3 ? 4.0 : 1.0);
+    new_dims.decompose(num_procs);
+    LoadBalancer::migrate(new_dims, vec);
+
+    elts_loc = new_dims.getNumEltsLoc();
+    beg_ind = new_dims.getBegIndicesGlob();
+    if (vec.getLocElts() != elts_loc.i * elts_loc.j)
+        check = EXIT_FAILURE;
+    for(int i = 0; i < elts_loc.i; ++i)
+        for(int j = 0; j < elts_loc.j; ++j)
+            if (vec(j + i * elts_loc.j) != (j + beg_ind.j) + (i + beg_ind.i) * 5)
+                check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::deepHalo2d() {
+    Dimensions dims;
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, x_deep, b, res;
+    Faces boundary_values;
+    Stencil stencil;
+    DeepHalo deep_halo;
+    int check = EXIT_SUCCESS;
+    IndicesIJ num_procs = {2, 2};
+    IndicesIJ elts_loc, beg_ind;
+    double omega = 2./3.;
+
+    dims.setNumEltsGlob({9, 7});
+    dims.decompose(num_procs);
+    elts_loc = dims.getNumEltsLoc();
+    beg_ind = dims.getBegIndicesGlob();
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    stencil.assemble(A, T);
+    x_deep.resize(dims);
+    res.resize(dims);
+
+    for(int i = 0; i < elts_loc.i; ++i)
+        for(int j = 0; j < elts_loc.j; ++j)
+            x(j + i * elts_loc.j) = 0.1 * (j + beg_ind.j) + 0.3 * (i + beg_ind.i);
+    x.exchangeRealHalo();
+
+    /* Two sweeps between the exchanges of a halo of two layers */
+    if (deep_halo.setup(stencil, dims, 2, b) == EXIT_FAILURE)
+        check = EXIT_FAILURE;
+    deep_halo.load(x);
+    deep_halo.exchange();
+    deep_halo.sweep(omega, 2);
+    deep_halo.exchange();
+    deep_halo.store(x_deep);
+
+    /* Two sweeps with an exchange of the regular halo after each */
+    for(int k = 0; k < 2; ++k) {
+        stencil.calculateResidual(x, b, res);
+        for(int n = 0; n < x.getLocElts(); ++n)
+            x(n) += omega * res(n) / stencil.getCentral(n);
+        x.exchangeRealHalo();
+    }
+
+    /* The order of the summation differs */
+    for(int n = 0; n < x.getLocElts(); ++n) {
+        if (fabs(x(n) - x_deep(n)) > 1e-12)
+            check = EXIT_FAILURE;
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::blocks2d() {
+    Dimensions dims;
+    int check = EXIT_SUCCESS;
+    IndicesIJ num_procs = {2, 2};
+    IndicesIJ elts_loc, grid;
+
+    dims.setNumEltsGlob({5, 5});
+    dims.decompose(num_procs);
+    elts_loc = dims.getNumEltsLoc();
+
+    /* Average sub-domain has 2x2 cells, so 4 blocks form a 2x2 grid */
+    if (dims.decomposeBlocks(4) == EXIT_FAILURE)
+        check = EXIT_FAILURE;
+    grid = dims.getDecomposition().getNumBlocks();
+    if (grid.i != 2 || grid.j != 2)
+        check = EXIT_FAILURE;
+
+    /* Blocks tile the sub-domain without gaps, the leading ones are larger */
+    IndicesIJ next(0, 0);
+    for(int bi = 0; bi < grid.i; ++bi) {
+        IndicesIJ elts_block, beg_block;
+        dims.getDecomposition().getBlock(IndicesIJ(bi, 0), elts_loc, elts_block, beg_block);
+        if (beg_block.i != next.i || elts_block.i != (elts_loc.i + 1 - bi) / 2)
+            check = EXIT_FAILURE;
+        next.i += elts_block.i;
+    }
+    for(int bj = 0; bj < grid.j; ++bj) {
+        IndicesIJ elts_block, beg_block;
+        dims.getDecomposition().getBlock(IndicesIJ(0, bj), elts_loc, elts_block, beg_block);
+        if (beg_block.j != next.j || elts_block.j != (elts_loc.j + 1 - bj) / 2)
+            check = EXIT_FAILURE;
+        next.j += elts_block.j;
+    }
+    if (next.i != elts_loc.i || next.j != elts_loc.j)
+        check = EXIT_FAILURE;
+
+    /* One sweep over the blocks is a damped Jacobi sweep of the sub-domain */
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, x_ref, b, res, res_ref;
+    Faces boundary_values;
+    Stencil stencil;
+    BlockJacobi block_jacobi;
+    IndicesIJ beg_ind = dims.getBegIndicesGlob();
+    double omega = 2./3.;
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    stencil.assemble(A, T);
+    x_ref.resize(dims);
+    res.resize(dims);
+    res_ref.resize(dims);
+
+    for(int i = 0; i < elts_loc.i; ++i)
+        for(int j = 0; j < elts_loc.j; ++j)
+            x(j + i * elts_loc.j) = 0.1 * (j + beg_ind.j) + 0.3 * (i + beg_ind.i);
+    x.exchangeRealHalo();
+    stencil.calculateResidual(x, b, res_ref);
+    for(int n = 0; n < x.getLocElts(); ++n)
+        x_ref(n) = x(n) + omega * res_ref(n) / stencil.getCentral(n);
+
+    block_jacobi.setup(stencil, dims, b);
+    block_jacobi.load(x);
+    block_jacobi.sweep(omega, res);
+    block_jacobi.store(x);
+
+    /* The order of the summation differs */
+    for(int n = 0; n < x.getLocElts(); ++n) {
+        if (fabs(x(n) - x_ref(n)) > 1e-12 || fabs(res(n) - res_ref(n)) > 1e-12)
+            check = EXIT_FAILURE;
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::blockDataflow2d() {
+    Dimensions dims;
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, b, x_graph, res, res_graph;
+    Faces boundary_values;
+    Stencil stencil;
+    BlockJacobi sweeps, graph;
+    int check = EXIT_SUCCESS;
+    IndicesIJ num_procs = {2, 2};
+
+    dims.setNumEltsGlob({9, 7});
+    dims.decompose(num_procs);
+    dims.decomposeBlocks(4);
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    stencil.assemble(A, T);
+    x_graph.resize(dims);
+    res.resize(dims);
+    res_graph.resize(dims);
+
+    /* The graph performs the same operations as the sweeps, so the results are identical */
+    sweeps.setup(stencil, dims, b);
+    graph.setup(stencil, dims, b);
+    sweeps.load(x);
+    graph.load(x);
+
+    for(int k = 0; k < 3; ++k)
+        sweeps.sweep(2./3., res);
+    sweeps.store(x);
+
+    graph.sweepDataflow(3, 2./3., res_graph);
+    graph.store(x_graph);
+
+    for(int n = 0; n < x.getLocElts(); ++n) {
+        if (x(n) != x_graph(n) || res(n) != res_graph(n))
+            check = EXIT_FAILURE;
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::reductions() {
+    int check = EXIT_SUCCESS;
+    int my_rank = getMyRank();
+    int num_procs = getNumProcs();
+
+    for(int hierarchical = 0; hierarchical < 2; ++hierarchical) {
+        Reduction reduction;
+        double values[2] = {(double)my_rank, 1.0};
+
+        reduction.setup(hierarchical == 1);
+
+        /* Nonblocking: progress until complete */
+        reduction.start(values, 2, REDUCE_SUM);
+        while (!reduction.test()) { }
+        if (reduction.getResult(0) != num_procs * (num_procs - 1) / 2 ||
+            reduction.getResult(1) != num_procs)
+            check = EXIT_FAILURE;
+
+        /* Blocking, in place */
+        reduction.reduce(values, 2, REDUCE_MAX);
+        if (values[0] != num_procs - 1 || values[1] != 1.0)
+            check = EXIT_FAILURE;
+
+        values[0] = my_rank + 1.0;
+        reduction.reduce(values, 1, REDUCE_MIN);
+        if (values[0] != 1.0)
+            check = EXIT_FAILURE;
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int Utests::overlappedSweeps2d() {
+    Dimensions dims;
+    System system;
+    Field T;
+    Matrix A;
+    Vector x, b, x_ref;
+    Faces boundary_values;
+    int check = EXIT_SUCCESS;
+    IndicesIJ num_procs = {2, 2};
+    IndicesIJ beg_ind;
+    double omega = 0.8;
+    const int comm_thread[] = {COMM_MASTER, COMM_DEDICATED};
+
+    dims.setNumEltsGlob({9, 7});
+    dims.decompose(num_procs);
+    beg_ind = dims.getBegIndicesGlob();
+
+    boundary_values.east = 10.;
+    boundary_values.west = 11.;
+    boundary_values.south = 12.;
+    boundary_values.north = 13.;
+    system.allocateMemory(dims, T, A, x, b);
+    system.assembleSystem(boundary_values, T, A, x, b);
+    x_ref.resize(dims);
+
+    for(int comm : comm_thread) {
+        for(int red_black = 0; red_black < 2; ++red_black) {
+            Solver solver;
+            SolverSettings settings;
+            const Stencil &stencil = solver.stencil;
+            IndicesIJ elts;
+
+            settings.comm_thread = comm;
+            solver.setSettings(settings);
+            solver.setupIteration(A, x, T);
+            elts = stencil.getNumElts();
+
+            for(int n = 0; n < x.getLocElts(); ++n)
+                x(n) = x_ref(n) = 0.1 * (n % elts.j + beg_ind.j) + 0.3 * (n / elts.j + beg_ind.i);
+            x.exchangeRealHalo();
+            x_ref.exchangeRealHalo();
+
+            /* The reference updates all cells first and then exchanges the halo */
+            for(int k = 0; k < 3; ++k) {
+                if (red_black == 0) {
+                    solver.sweepJacobi(stencil, omega, x, b);
+
+                    vector<double> x_next(x_ref.getLocElts());
+                    for(int n = 0; n < x_ref.getLocElts(); ++n) {
+                        double x_jac = (b(n) - stencil.offDiagonal(x_ref.getData(), n))
+                                     / stencil.getCentral(n);
+                        x_next[n] = x_ref(n) + omega * (x_jac - x_ref(n));
+                    }
+                    for(int n = 0; n < x_ref.getLocElts(); ++n)
+                        x_ref(n) = x_next[n];
+                    x_ref.exchangeRealHalo();
+                }
+                else {
+                    for(int color = 0; color < 2; ++color) {
+                        solver.sweepRedBlack(stencil, color, omega, x, b);
+
+                        for(int n = 0; n < x_ref.getLocElts(); ++n) {
+                            if ((n / elts.j + n % elts.j) % 2 != color)
+                                continue;
+                            double x_gs = (b(n) - stencil.offDiagonal(x_ref.getData(), n))
+                                        / stencil.getCentral(n);
+                            x_ref(n) += omega * (x_gs - x_ref(n));
+                        }
+                        x_ref.exchangeRealHalo();
+                    }
+                }
+            }
+
+            /* Same operations in the same order, so the halo cells match as well */
+            for(int n = 0; n < x.numRows(); ++n) {
+                if (x(n) != x_ref(n))
+                    check = EXIT_FAILURE;
+            }
+        }
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#ifdef USE_THREADS
+int Utests::threadMailboxes() {
+    int check = EXIT_SUCCESS;
+    int my_rank = getMyRank();
+    int num_procs = getNumProcs();
+    int next = (my_rank + 1) % num_procs;
+    int prev = (my_rank + num_procs - 1) % num_procs;
+    double message[2] = {0.0, 0.0};
+
+    /* Two messages around the ring with the same tag and one with another tag */
+    for(int n = 0; n < 2; ++n) {
+        message[0] = my_rank;
+        message[1] = n;
+        threadSend(next, 1, message, 2);
+    }
+    message[0] = -my_rank;
+    threadSend(next, 2, message, 1);
+
+    /* The other tag is received first, the rest arrives in the order of sending */
+    threadRecv(prev, 2, message, 1);
+    if (message[0] != -prev)
+        check = EXIT_FAILURE;
+    for(int n = 0; n < 2; ++n) {
+        threadRecv(prev, 1, message, 2);
+        if (message[0] != prev || message[1] != n)
+            check = EXIT_FAILURE;
+    }
+
+    /* Reduction over all ranks */
+    message[0] = my_rank;
+    message[1] = -my_rank;
+    threadAllreduce(message, 2, REDUCE_MAX);
+    if (message[0] != num_procs - 1 || message[1] != 0.0)
+        check = EXIT_FAILURE;
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
+
+#ifdef USE_POOL
+int Utests::threadPool() {
+    int check = EXIT_SUCCESS;
+    ThreadPool &pool = ThreadPool::getInstance();
+    vector<int> counts(100, 0);
+
+    /* Every task and every chunk is executed exactly once */
+    for(int n = 0; n < (int)counts.size(); ++n)
+        pool.submit(n, counts.size(), [&counts, n]() { ++counts[n]; });
+    pool.wait();
+
+    pool.parallelFor(10, (int)counts.size(), [&counts](int beg, int end) {
+        for(int n = beg; n < end; ++n)
+            ++counts[n];
+    });
+
+    for(int n = 0; n < (int)counts.size(); ++n) {
+        if (counts[n] != ((n < 10) ? 1 : 2))
+            check = EXIT_FAILURE;
+    }
+
+    // This one is based on the assumtion that EXIT_SUCCESS is always 0
+    findGlobalSum(check);
+    return check > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+#endif
@@ -44,12 +44,51 @@ class Utests {
 
     int vectorHalo1d();
     int vectorHalo2d();
+    int vectorHaloPrecision2d();
+#ifdef USE_MPI
+    int haloPlans2d();
+    int asyncHalo2d();
+#endif
 
     int fieldIDs2d();
 
     int matrixAssembly2d();
 
     int norm2d();
+    int anderson2d();
+#ifndef USE_THREADS
+    int asyncSolver2d();
+#endif
+
+    int tridiagonal1d();
+
+    int bandedCholesky2d();
+
+    int relaxationFactor();
+
+    int processGrid();
+    int nodeGrid();
+
+    int weightedDecomposition1d();
+
+    int migration2d();
+
+    int deepHalo2d();
+
+    int blocks2d();
+    int blockDataflow2d();
+
+    int reductions();
+
+    int overlappedSweeps2d();
+
+#ifdef USE_POOL
+    int threadPool();
+#endif
+
+#ifdef USE_THREADS
+    int threadMailboxes();
+#endif
 public:
     int runAll();
 };
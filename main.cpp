@@ -24,11 +24,13 @@
  * @file main.cpp
  * @brief The starting point.
  * A simple MPI/OpenMP code that solves a 2D Poisson equation (no sources or
- * sinks) on a uniform structured grid using Jacobi method.
+ * sinks) on a uniform structured grid using Jacobi method (or one of its
+ * variations, see \e Solver).
  */
 
 #include "General/helpers.h"
 #include "MPI/common.h"
+#include "MPI/threads.h"
 #include "System/system.h"
 #include "Solver/solver.h"
 #include "IO/io.h"
@@ -69,6 +71,7 @@ void runProblem(int argc, char** argv) {
     Faces boundary_values;      // Boundary data
     System system;              // Object of the linear system
     Solver solver;              // Object of mathematical functions
+    SolverSettings settings;    // Type of the solver and its parameters
     IO io;                      // Object for IO operations
     Helpers helpers;            // Object of auxiliary functions
     double elp_time[4] = {0};   // Elapsed time, [s]
@@ -77,7 +80,8 @@ void runProblem(int argc, char** argv) {
      * Check input from the command line and determine properties of the
      * numerical grid.
      */
-    helpers.setDimensionsAndDecompose(argc, argv, dims);
+    helpers.setDimensionsAndDecompose(argc, argv, dims, settings);
+    solver.setSettings(settings);
 
     /* 
      * Set boundary values at walls. Note, all boundary conditions are
@@ -96,9 +100,12 @@ void runProblem(int argc, char** argv) {
 
     /* Solve the linear system. */
     elp_time[0] = helpers.tic();
-    solver.solveJacobi(A, x, b);
+    solver.solve(A, x, b, T);
     elp_time[1] = helpers.toc();
 
+    /* The solver may have moved the cut lines to balance the load. */
+    dims = T.getDimensions();
+
     /* Copy final solution back to the filed. */
     system.copySolution(x, T);
 
@@ -108,11 +115,16 @@ void runProblem(int argc, char** argv) {
     elp_time[3] = helpers.toc();
 
     /* Report elapsed time. */
-    reportElapsedTime(elp_time[0], elp_time[1], "Jacobi");
+    reportElapsedTime(elp_time[0], elp_time[1], "Solver");
     reportElapsedTime(elp_time[2], elp_time[3], "IO");
 }
 
-int main(int argc, char** argv) {
+/*!
+ * @brief Run the program by a single process.
+ * @param argc [in] Number of command line arguments
+ * @param argv [in] Vector of command line arguments
+ */
+int runProcess(int argc, char** argv) {
 
     int exit_status = EXIT_SUCCESS;
     /*
@@ -136,3 +148,13 @@ int main(int argc, char** argv) {
 
     return exit_status;
 }
+
+int main(int argc, char** argv) {
+
+#ifdef USE_THREADS
+    /* Every process is a thread of this program, see MPI/threads.h. */
+    return runThreadRanks(findNumThreadRanks(argc, argv), runProcess, argc, argv);
+#else
+    return runProcess(argc, argv);
+#endif
+}
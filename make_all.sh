@@ -96,8 +96,9 @@ function _check_cpp_compiler() {
 # ####################################### #
 if [ $# -eq 0 ]
 then
-    echo "The compilation type in not specified. Please, use 'omp', 'mpi', 'hybrid', or 'gpu' " >&2
-    echo "to compile with OpenMP, MPI, hybrid, or GPU parallelism, respectively." >&2
+    echo "The compilation type in not specified. Please, use 'omp', 'mpi', 'hybrid', 'pool', 'threads'," >&2
+    echo "or 'gpu' to compile with OpenMP, MPI, hybrid, hybrid with the thread pool, thread-based," >&2
+    echo "or GPU parallelism, respectively." >&2
     exit 1
 elif [ $1 = "mpi" ]
 then
@@ -125,14 +126,25 @@ then
     else
         extra_flags+=(-fopenmp)
     fi
+elif [ $1 = "pool" ]
+then
+    read compiler < <( _check_mpi_version ) || exit 1
+    echo "Compiling in a hybrid mode with '$compiler' and the thread pool instead of OpenMP..." >&2
+    extra_flags=(-DUSE_MPI -DUSE_POOL -lmpi -pthread)
+elif [ $1 = "threads" ]
+then
+    read compiler < <( _check_cpp_compiler ) || exit 1
+    echo "Compiling with '$compiler' and the processes running as threads..." >&2
+    extra_flags+=(-DUSE_THREADS -pthread)
 elif [ $1 = "gpu" ]
 then
     read compiler < <( _check_cpp_compiler ) || exit 1
     echo "Compiling with $compiler' and support for the OpenMP offloading..." >&2
     extra_flags=(-fopenmp -foffload=nvptx-none='-misa=sm_35 -Ofast -lm')
 else
-    echo "Error: Incorrect compilation type is specified. Please, use 'omp', 'mpi' or 'hybrid' " >&2
-    echo "       to compile with OpenMP, MPI or hybrid parallelism, respectively." >&2
+    echo "Error: Incorrect compilation type is specified. Please, use 'omp', 'mpi', 'hybrid', 'pool' or " >&2
+    echo "       'threads' to compile with OpenMP, MPI, hybrid, hybrid with the thread pool or" >&2
+    echo "       thread-based parallelism, respectively." >&2
     exit 1
 fi
 
@@ -158,12 +170,26 @@ $compiler \
     IO/io.cpp \
     General/helpers.cpp \
     Solver/solver.cpp \
+    Solver/tridiagonal.cpp \
+    Solver/relaxation.cpp \
+    Solver/convergence.cpp \
+    Solver/schwarz.cpp \
+    Solver/banded_cholesky.cpp \
+    Solver/deep_halo.cpp \
+    Solver/block_jacobi.cpp \
+    Solver/load_balancer.cpp \
     System/system.cpp \
     General/dimensions.cpp \
+    General/thread_pool.cpp \
     main.cpp \
     MPI/common.cpp \
+    MPI/reduction.cpp \
+    MPI/threads.cpp \
     MPI/Decomposition/decomposition.cpp \
     DataTypes/matrix.cpp \
     DataTypes/vector.cpp \
     DataTypes/field.cpp \
+    DataTypes/stencil.cpp \
+    DataTypes/async_halo.cpp \
+    DataTypes/halo_plan.cpp \
     Tests/utests.cpp